@@ -0,0 +1,392 @@
+#include "AngleSolver.h"
+
+// Constructor for AngleSolver objects. tolerance is the allowed apogee error as a fraction of
+// TARGET_APOGEE. The search is limited to angles between 0 and MAX_PADDLE_ANGLE.
+AngleSolver::AngleSolver(AngleSolverMethod method, double tolerance)
+{
+    this->method = method;
+    this->tolerance = tolerance;
+    minAngle = 0;
+    maxAngle = MAX_PADDLE_ANGLE;
+    maxIterations = 100;
+}
+
+
+// Finds the paddle angle that brings the rocket to TARGET_APOGEE. apogeeAt runs one simulation with
+// the given constant paddle angle (rad) and returns the apogee (m). The angle returned in a converged
+// solution is always the last angle passed to apogeeAt.
+AngleSolution AngleSolver::solve(const function<double(double)>& apogeeAt)
+{
+    int numSimulations = 0;
+    function<double(double)> countedApogeeAt = [&](double angle)
+    {
+        numSimulations++;
+        return apogeeAt(angle);
+    };
+
+    AngleSolution soln;
+    if (method == STEPPING) soln = solveStepping(countedApogeeAt);
+    else if (method == BISECTION) soln = solveBisection(countedApogeeAt);
+    else if (method == SECANT) soln = solveSecant(countedApogeeAt);
+    else soln = solveBrent(countedApogeeAt);
+
+    soln.numSimulations = numSimulations;
+    return soln;
+}
+
+
+// Finds the paddle angle starting from a guess, for example one extrapolated from neighbouring grid
+// points, instead of the method's usual starting point. The search steps away from the guess by
+// angleStep (rad), doubling the step until the target is bracketed, then finishes with Brent's method,
+// so a good guess needs only one or two simulations.
+AngleSolution AngleSolver::solve(const function<double(double)>& apogeeAt, double angleGuess, double angleStep)
+{
+    int numSimulations = 0;
+    function<double(double)> countedApogeeAt = [&](double angle)
+    {
+        numSimulations++;
+        return apogeeAt(angle);
+    };
+
+    AngleSolution soln = solveWarm(countedApogeeAt, angleGuess, angleStep);
+    soln.numSimulations = numSimulations;
+    return soln;
+}
+
+
+void AngleSolver::setMethod(AngleSolverMethod method)
+{
+    this->method = method;
+}
+
+
+AngleSolverMethod AngleSolver::getMethod()
+{
+    return method;
+}
+
+
+string AngleSolver::methodName(AngleSolverMethod method)
+{
+    if (method == STEPPING) return "Stepping";
+    else if (method == BISECTION) return "Bisection";
+    else if (method == SECANT) return "Secant";
+    else return "Brent";
+}
+
+
+bool AngleSolver::withinTolerance(double apogee)
+{
+    return abs(apogee - TARGET_APOGEE) < TARGET_APOGEE*tolerance;
+}
+
+
+// Original search. Starts at 10 degrees and walks the angle in fixed increments that shrink as the
+// apogee gets closer to the target, until the angle stops changing.
+AngleSolution AngleSolver::solveStepping(const function<double(double)>& apogeeAt)
+{
+    double finalApogee = 0;     //m
+    double deploymentAngle = 10 * (M_PI/180);   //radians
+    double angleStep = 0 * (M_PI/180);   //radians
+    bool keepLooping = true;
+
+    AngleSolution soln;
+    while(keepLooping)
+    {
+        keepLooping = false;
+        finalApogee = apogeeAt(deploymentAngle);
+        soln.deploymentAngle = deploymentAngle;
+        soln.finalApogee = finalApogee;
+        double previousAngle = deploymentAngle;
+        adjustAngle(deploymentAngle, angleStep, finalApogee);
+
+        if (deploymentAngle > maxAngle || deploymentAngle < minAngle) break;
+
+        // check if angle changed using double comparison method
+        // if the angle changed, loop again
+        if (abs(previousAngle - deploymentAngle) > 0.0001) keepLooping = true;
+    }
+
+    soln.converged = withinTolerance(soln.finalApogee);
+    return soln;
+}
+
+
+// Increase or decrease the selected deployment angle for the next simulation depending on the results
+// of the previous simulation. A variable angle step is used to reduce computation time
+void AngleSolver::adjustAngle(double& deploymentAngle, double& angleStep, double finalApogee)
+{
+    // adjust angle step based on how close the simulation is to the target
+    if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.5) angleStep = 3 * (M_PI/180);
+    else if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.25) angleStep = 1 * (M_PI/180);
+    else if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.1) angleStep = 0.5 * (M_PI/180);
+    else /*if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.03)*/ angleStep = 0.05 * (M_PI/180);
+
+    // adjust deployment angle up if the rocket overshot the target, else adjust down
+    if (finalApogee > TARGET_APOGEE*(1+tolerance)) deploymentAngle += angleStep;
+    else if (finalApogee < TARGET_APOGEE*(1-tolerance)) deploymentAngle -= angleStep;
+}
+
+
+// Halves the [0, MAX_PADDLE_ANGLE] bracket until the apogee is within tolerance. If the ends of the
+// range do not bracket the target, the rocket cannot reach it with a constant angle.
+AngleSolution AngleSolver::solveBisection(const function<double(double)>& apogeeAt)
+{
+    AngleSolution soln;
+    soln.converged = false;
+
+    double lo = minAngle, hi = maxAngle;
+    double apogeeLo = apogeeAt(lo);
+    soln.deploymentAngle = lo;
+    soln.finalApogee = apogeeLo;
+    if (withinTolerance(apogeeLo) || apogeeLo < TARGET_APOGEE)
+    {
+        soln.converged = withinTolerance(apogeeLo);
+        return soln;
+    }
+
+    double apogeeHi = apogeeAt(hi);
+    soln.deploymentAngle = hi;
+    soln.finalApogee = apogeeHi;
+    if (withinTolerance(apogeeHi) || apogeeHi > TARGET_APOGEE)
+    {
+        soln.converged = withinTolerance(apogeeHi);
+        return soln;
+    }
+
+    for (int i = 0; i < maxIterations; i++)
+    {
+        double mid = 0.5*(lo + hi);
+        double apogeeMid = apogeeAt(mid);
+        soln.deploymentAngle = mid;
+        soln.finalApogee = apogeeMid;
+        if (withinTolerance(apogeeMid))
+        {
+            soln.converged = true;
+            return soln;
+        }
+
+        // apogee decreases as the angle increases
+        if (apogeeMid > TARGET_APOGEE) lo = mid;
+        else hi = mid;
+    }
+    return soln;
+}
+
+
+// Secant iteration started from 10 and 20 degrees. Iterates are clamped to the allowed angle range.
+// Converges quickly on the smooth apogee curve but is not guaranteed to converge like the
+// bracketed methods.
+AngleSolution AngleSolver::solveSecant(const function<double(double)>& apogeeAt)
+{
+    AngleSolution soln;
+    soln.converged = false;
+
+    double x0 = 10 * (M_PI/180);
+    double f0 = apogeeAt(x0) - TARGET_APOGEE;
+    soln.deploymentAngle = x0;
+    soln.finalApogee = f0 + TARGET_APOGEE;
+    if (withinTolerance(soln.finalApogee))
+    {
+        soln.converged = true;
+        return soln;
+    }
+
+    double x1 = 20 * (M_PI/180);
+    for (int i = 0; i < maxIterations; i++)
+    {
+        double f1 = apogeeAt(x1) - TARGET_APOGEE;
+        soln.deploymentAngle = x1;
+        soln.finalApogee = f1 + TARGET_APOGEE;
+        if (withinTolerance(soln.finalApogee))
+        {
+            soln.converged = true;
+            return soln;
+        }
+        if (f1 == f0) break;
+
+        double x2 = x1 - f1*(x1 - x0)/(f1 - f0);
+        if (x2 < minAngle) x2 = minAngle;
+        else if (x2 > maxAngle) x2 = maxAngle;
+        if (x2 == x1) break;   //stuck against a limit of the angle range
+
+        x0 = x1;
+        f0 = f1;
+        x1 = x2;
+    }
+    return soln;
+}
+
+
+// Brent's method on [0, MAX_PADDLE_ANGLE]. Uses inverse quadratic interpolation or secant steps when
+// they stay well inside the bracket and falls back on bisection otherwise, so it keeps the guaranteed
+// convergence of bisection while usually needing only a few simulations.
+AngleSolution AngleSolver::solveBrent(const function<double(double)>& apogeeAt)
+{
+    AngleSolution soln;
+    soln.converged = false;
+
+    double a = minAngle, b = maxAngle;
+    double fa = apogeeAt(a) - TARGET_APOGEE;
+    soln.deploymentAngle = a;
+    soln.finalApogee = fa + TARGET_APOGEE;
+    if (withinTolerance(soln.finalApogee) || fa < 0)
+    {
+        soln.converged = withinTolerance(soln.finalApogee);
+        return soln;
+    }
+
+    double fb = apogeeAt(b) - TARGET_APOGEE;
+    soln.deploymentAngle = b;
+    soln.finalApogee = fb + TARGET_APOGEE;
+    if (withinTolerance(soln.finalApogee) || fb > 0)
+    {
+        soln.converged = withinTolerance(soln.finalApogee);
+        return soln;
+    }
+
+    return solveBracket(apogeeAt, a, fa, b, fb);
+}
+
+
+// Brackets the target starting from angleGuess. The apogee decreases as the angle grows, so the search
+// steps up from the guess if the apogee is too high and down if it is too low. If a limit of the angle
+// range is reached without crossing the target, the target cannot be reached with a constant angle.
+AngleSolution AngleSolver::solveWarm(const function<double(double)>& apogeeAt, double angleGuess, double angleStep)
+{
+    AngleSolution soln;
+    soln.converged = false;
+
+    double a = min(max(angleGuess, minAngle), maxAngle);
+    double fa = apogeeAt(a) - TARGET_APOGEE;
+    soln.deploymentAngle = a;
+    soln.finalApogee = fa + TARGET_APOGEE;
+    if (withinTolerance(soln.finalApogee))
+    {
+        soln.converged = true;
+        return soln;
+    }
+
+    double direction = (fa > 0) ? 1 : -1;
+    double step = max(angleStep, 1e-6);
+    for (int i = 0; i < maxIterations; i++)
+    {
+        double limit = (direction > 0) ? maxAngle : minAngle;
+        if (a == limit) return soln;    //cannot reach the target
+
+        double b = a + direction*step;
+        if ((direction > 0 && b > maxAngle) || (direction < 0 && b < minAngle)) b = limit;
+        double fb = apogeeAt(b) - TARGET_APOGEE;
+        soln.deploymentAngle = b;
+        soln.finalApogee = fb + TARGET_APOGEE;
+        if (withinTolerance(soln.finalApogee))
+        {
+            soln.converged = true;
+            return soln;
+        }
+        if ((fa > 0) != (fb > 0)) return solveBracket(apogeeAt, a, fa, b, fb);
+
+        a = b;
+        fa = fb;
+        step *= 2;
+    }
+    return soln;
+}
+
+
+// Brent's method on the bracket [a, b], where fa and fb are the apogee errors at the ends and have
+// opposite signs. Stops as soon as the apogee is within tolerance.
+AngleSolution AngleSolver::solveBracket(const function<double(double)>& apogeeAt, double a, double fa,
+    double b, double fb)
+{
+    const double ANGLE_TOLERANCE = 1e-7;     //rad
+
+    AngleSolution soln;
+    soln.converged = false;
+    soln.deploymentAngle = b;
+    soln.finalApogee = fb + TARGET_APOGEE;
+
+    double c = a, fc = fa;
+    double d = b - a, e = d;
+    for (int i = 0; i < maxIterations; i++)
+    {
+        // keep the root between b and c
+        if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0))
+        {
+            c = a;
+            fc = fa;
+            d = b - a;
+            e = d;
+        }
+        // b is always the best estimate so far
+        if (abs(fc) < abs(fb))
+        {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+
+        double tol1 = 2*numeric_limits<double>::epsilon()*abs(b) + 0.5*ANGLE_TOLERANCE;
+        double xm = 0.5*(c - b);
+        if (abs(xm) <= tol1) break;    //bracket collapsed without reaching the apogee tolerance
+
+        if (abs(e) >= tol1 && abs(fa) > abs(fb))
+        {
+            double p, q, r;
+            double s = fb/fa;
+            if (a == c)
+            {
+                // secant step
+                p = 2*xm*s;
+                q = 1 - s;
+            }
+            else
+            {
+                // inverse quadratic interpolation
+                q = fa/fc;
+                r = fb/fc;
+                p = s*(2*xm*q*(q - r) - (b - a)*(r - 1));
+                q = (q - 1)*(r - 1)*(s - 1);
+            }
+            if (p > 0) q = -q;
+            p = abs(p);
+
+            // accept the interpolation only if it falls well inside the bracket
+            double min1 = 3*xm*q - abs(tol1*q);
+            double min2 = abs(e*q);
+            if (2*p < min(min1, min2))
+            {
+                e = d;
+                d = p/q;
+            }
+            else
+            {
+                d = xm;
+                e = d;
+            }
+        }
+        else
+        {
+            d = xm;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        if (abs(d) > tol1) b += d;
+        else b += (xm > 0) ? tol1 : -tol1;
+
+        fb = apogeeAt(b) - TARGET_APOGEE;
+        soln.deploymentAngle = b;
+        soln.finalApogee = fb + TARGET_APOGEE;
+        if (withinTolerance(soln.finalApogee))
+        {
+            soln.converged = true;
+            return soln;
+        }
+    }
+    return soln;
+}
@@ -0,0 +1,67 @@
+#ifndef ANGLE_SOLVER_H
+#define ANGLE_SOLVER_H
+
+/*
+File: AngleSolver.h
+Author: Gerritt Graham
+Description: Root finders used by the Generator class to find the constant paddle deployment angle
+that brings the rocket to the target apogee. The solvers work on apogee(angle) - TARGET_APOGEE, which
+decreases as the angle grows, and are bracketed by 0 and MAX_PADDLE_ANGLE. Every evaluation of the
+apogee function is a full simulation, so each solver counts how many it used.
+*/
+
+#include "consts.h"
+#include <functional>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+enum AngleSolverMethod
+{
+    STEPPING,       //original fixed increment search
+    BISECTION,
+    SECANT,
+    BRENT
+};
+
+// Result of a single angle search
+struct AngleSolution
+{
+    double deploymentAngle;     //rad
+    double finalApogee;         //apogee reached with deploymentAngle, m
+    int numSimulations;         //number of times the apogee function was evaluated
+    bool converged;             //true if the apogee is within tolerance of TARGET_APOGEE
+};
+
+class AngleSolver
+{
+    public:
+    AngleSolver(AngleSolverMethod method = BRENT, double tolerance = 0.001);
+    AngleSolution solve(const function<double(double)>& apogeeAt);
+    AngleSolution solve(const function<double(double)>& apogeeAt, double angleGuess, double angleStep);
+    void setMethod(AngleSolverMethod method);
+    AngleSolverMethod getMethod();
+    static string methodName(AngleSolverMethod method);
+
+    private:
+    AngleSolverMethod method;
+    double tolerance;           //fraction of TARGET_APOGEE
+    double minAngle, maxAngle;  //rad
+    int maxIterations;
+
+    AngleSolution solveStepping(const function<double(double)>& apogeeAt);
+    AngleSolution solveBisection(const function<double(double)>& apogeeAt);
+    AngleSolution solveSecant(const function<double(double)>& apogeeAt);
+    AngleSolution solveBrent(const function<double(double)>& apogeeAt);
+    AngleSolution solveWarm(const function<double(double)>& apogeeAt, double angleGuess, double angleStep);
+    AngleSolution solveBracket(const function<double(double)>& apogeeAt, double a, double fa, double b, double fb);
+    bool withinTolerance(double apogee);
+    void adjustAngle(double& deploymentAngle, double& angleStep, double finalApogee);
+
+};
+
+
+#endif //ANGLE_SOLVER_H
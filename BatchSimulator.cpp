@@ -0,0 +1,350 @@
+#include "BatchSimulator.h"
+#include "Simulator.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Constructor for BatchSimulator objects. recordPolicy applies to every flight in the batch; the
+// default keeps no records and only reports apogees.
+BatchSimulator::BatchSimulator(RecordPolicy recordPolicy, double recordInterval)
+{
+    this->recordPolicy = recordPolicy;
+    this->recordInterval = recordInterval;
+    heightStep = Simulator::HEIGHT_STEP;
+    controlPeriod = 0;
+    numFlights = 0;
+}
+
+
+// Adds a flight starting at MECO height h0 (m) and velocity V0 (m/s) and returns its number. Like
+// Simulator, a non-negative alpha is a fixed paddle angle (rad) and -1 hands the paddles to
+// controller. Every controlled flight needs its own Controller, which must outlive simulate().
+int BatchSimulator::addFlight(double h0, double V0, double alpha, Controller* controller)
+{
+    h.resize(numFlights);
+    V.resize(numFlights);
+    a.resize(numFlights);
+    currTime.resize(numFlights);
+    lastTime.resize(numFlights);
+    this->alpha.resize(numFlights);
+    paddleDrag.resize(numFlights);
+    fixedAngle.resize(numFlights);
+    mass.resize(numFlights);
+    dragScale.resize(numFlights);
+    activeFlags.resize(numFlights);
+
+    h.push_back(h0);
+    V.push_back(V0);
+    a.push_back(-g);
+    currTime.push_back(t_c);
+    lastTime.push_back(t_c);
+    this->alpha.push_back(0);
+    paddleDrag.push_back(Simulator::getPaddleDrag(0));
+    fixedAngle.push_back(alpha);
+    mass.push_back(m_r);
+    dragScale.push_back(1);
+    activeFlags.push_back(1);
+    numSteps.push_back(0);
+    controlTicks.push_back(0);
+    heldCommand.push_back(0);
+    controllers.push_back(controller);
+
+    // record data for the rocket at MECO
+    if (records.size() <= numFlights) records.emplace_back();
+    FlightRecord& record = records.at(numFlights);
+    record.setPolicy(recordPolicy, recordInterval);
+    record.clear();
+    record.reserveFlight(V0, heightStep);
+    record.addSample(t_c, h0, V0, -g, 0, true);
+
+    return numFlights++;
+}
+
+
+// Removes every flight so the batch can be reused. Record capacity is kept.
+void BatchSimulator::clear()
+{
+    numFlights = 0;
+    numSteps.clear();
+    controlTicks.clear();
+    heldCommand.clear();
+    controllers.clear();
+}
+
+
+// Scales the mass and drag area of one flight, like Simulator::setDispersion()
+void BatchSimulator::setDispersion(int flight, double massScale, double dragScale)
+{
+    mass.at(flight) = m_r*massScale;
+    this->dragScale.at(flight) = dragScale;
+}
+
+
+// Runs the controllers once per controlPeriod (s) of flight time, holding each command in between,
+// like Simulator::setControlPeriod(). The default of 0 runs them after every step.
+void BatchSimulator::setControlPeriod(double controlPeriod)
+{
+    this->controlPeriod = controlPeriod;
+}
+
+
+// Runs every flight to apogee
+void BatchSimulator::simulate()
+{
+    padState();
+
+    int numActive = numFlights;
+    while (numActive > 0)
+    {
+        stepAll();
+        numActive = updatePaddles();
+    }
+}
+
+
+int BatchSimulator::getNumFlights()
+{
+    return numFlights;
+}
+
+
+// Returns height of the rocket at the end of the simulation
+double BatchSimulator::getApogee(int flight)
+{
+    return h.at(flight);
+}
+
+
+int BatchSimulator::getNumSteps(int flight)
+{
+    return numSteps.at(flight);
+}
+
+
+FlightRecord& BatchSimulator::getRecord(int flight)
+{
+    return records.at(flight);
+}
+
+
+// Queues the record of one flight to be written in the background, like Simulator::writeRecord()
+void BatchSimulator::writeRecord(int flight, string fileSpec)
+{
+    RecordWriter::instance().submit(fileSpec, records.at(flight).decimate(0.1));
+}
+
+
+// Name of the kernel compiled into this build
+string BatchSimulator::kernelName()
+{
+#if defined(__AVX512F__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+
+// Pads the state arrays to a multiple of the widest kernel with flights that have already finished,
+// so the vector kernels never need a remainder loop
+void BatchSimulator::padState()
+{
+    int paddedSize = ((numFlights + LANE_PADDING - 1) / LANE_PADDING) * LANE_PADDING;
+    h.resize(paddedSize, 0);
+    V.resize(paddedSize, 0);
+    a.resize(paddedSize, 0);
+    currTime.resize(paddedSize, 0);
+    lastTime.resize(paddedSize, 0);
+    alpha.resize(paddedSize, 0);
+    paddleDrag.resize(paddedSize, 0);
+    fixedAngle.resize(paddedSize, 0);
+    mass.resize(paddedSize, m_r);
+    dragScale.resize(paddedSize, 0);
+    activeFlags.resize(paddedSize, 0);
+    for (int i = numFlights; i < paddedSize; i++) activeFlags.at(i) = 0;
+}
+
+
+// Performs one energy balance height step for every flight that has not reached apogee. This is the
+// same arithmetic as Simulator::energyStep() and the time update in Simulator::calcNextStep(), written
+// out on whole vectors of flights. Finished flights are computed but masked out.
+void BatchSimulator::stepAll()
+{
+    int paddedSize = activeFlags.size();
+    int i = 0;
+
+#if defined(__AVX512F__)
+    const __m512d dh = _mm512_set1_pd(heightStep);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d two = _mm512_set1_pd(2);
+    const __m512d gravity = _mm512_set1_pd(g);
+    const __m512d rocketDrag = _mm512_set1_pd(A_r*Cd_r);
+    const __m512d rho0 = _mm512_set1_pd(1.2);
+    const __m512d rhoSlope = _mm512_set1_pd(0.00012);
+    const __m512d padHeight = _mm512_set1_pd(launchPadHeight);
+    const __m512d zero = _mm512_setzero_pd();
+    for (; i + 8 <= paddedSize; i += 8)
+    {
+        __mmask8 active = _mm512_cmp_pd_mask(_mm512_loadu_pd(&activeFlags[i]), zero, _CMP_GT_OQ);
+        if (!active) continue;
+
+        __m512d hv = _mm512_loadu_pd(&h[i]);
+        __m512d Vv = _mm512_loadu_pd(&V[i]);
+        __m512d tv = _mm512_loadu_pd(&currTime[i]);
+        __m512d massv = _mm512_loadu_pd(&mass[i]);
+        __m512d mg = _mm512_mul_pd(massv, gravity);
+        __m512d halfMass = _mm512_mul_pd(half, massv);
+
+        __m512d totalEnergy = _mm512_add_pd(_mm512_mul_pd(mg, hv), _mm512_mul_pd(_mm512_mul_pd(halfMass, Vv), Vv));
+        __m512d rho = _mm512_sub_pd(rho0, _mm512_mul_pd(rhoSlope, _mm512_add_pd(hv, padHeight)));
+        __m512d energyLoss = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(half, rho), Vv), Vv),
+            _mm512_add_pd(rocketDrag, _mm512_loadu_pd(&paddleDrag[i])));
+        energyLoss = _mm512_mul_pd(_mm512_mul_pd(energyLoss, _mm512_loadu_pd(&dragScale[i])), dh);
+        totalEnergy = _mm512_sub_pd(totalEnergy, energyLoss);
+        __m512d hNew = _mm512_add_pd(hv, dh);
+        __m512d potential = _mm512_mul_pd(mg, hNew);
+
+        __mmask8 climbs = _mm512_cmp_pd_mask(totalEnergy, potential, _CMP_GT_OQ);
+        __m512d VClimb = _mm512_sqrt_pd(_mm512_div_pd(_mm512_mul_pd(two, _mm512_sub_pd(totalEnergy, potential)), massv));
+        __m512d hApogee = _mm512_add_pd(hNew, _mm512_div_pd(_mm512_mul_pd(_mm512_mul_pd(half, Vv), Vv), gravity));
+        __m512d VNew = _mm512_mask_blend_pd(climbs, zero, VClimb);
+        hNew = _mm512_mask_blend_pd(climbs, hApogee, hNew);
+
+        __m512d timeStep = _mm512_div_pd(dh, VNew);
+        __m512d accel = _mm512_div_pd(_mm512_sub_pd(VNew, Vv), timeStep);
+        timeStep = _mm512_mask_blend_pd(climbs, _mm512_div_pd(dh, Vv), timeStep);
+        tv = _mm512_add_pd(tv, timeStep);
+
+        _mm512_storeu_pd(&h[i], _mm512_mask_blend_pd(active, hv, hNew));
+        _mm512_storeu_pd(&V[i], _mm512_mask_blend_pd(active, Vv, VNew));
+        _mm512_storeu_pd(&a[i], _mm512_mask_blend_pd(active, _mm512_loadu_pd(&a[i]), accel));
+        _mm512_storeu_pd(&currTime[i], _mm512_mask_blend_pd(active, _mm512_loadu_pd(&currTime[i]), tv));
+    }
+#elif defined(__AVX2__)
+    const __m256d dh = _mm256_set1_pd(heightStep);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d two = _mm256_set1_pd(2);
+    const __m256d gravity = _mm256_set1_pd(g);
+    const __m256d rocketDrag = _mm256_set1_pd(A_r*Cd_r);
+    const __m256d rho0 = _mm256_set1_pd(1.2);
+    const __m256d rhoSlope = _mm256_set1_pd(0.00012);
+    const __m256d padHeight = _mm256_set1_pd(launchPadHeight);
+    const __m256d zero = _mm256_setzero_pd();
+    for (; i + 4 <= paddedSize; i += 4)
+    {
+        __m256d active = _mm256_cmp_pd(_mm256_loadu_pd(&activeFlags[i]), zero, _CMP_GT_OQ);
+        if (_mm256_movemask_pd(active) == 0) continue;
+
+        __m256d hv = _mm256_loadu_pd(&h[i]);
+        __m256d Vv = _mm256_loadu_pd(&V[i]);
+        __m256d tv = _mm256_loadu_pd(&currTime[i]);
+        __m256d massv = _mm256_loadu_pd(&mass[i]);
+        __m256d mg = _mm256_mul_pd(massv, gravity);
+        __m256d halfMass = _mm256_mul_pd(half, massv);
+
+        __m256d totalEnergy = _mm256_add_pd(_mm256_mul_pd(mg, hv), _mm256_mul_pd(_mm256_mul_pd(halfMass, Vv), Vv));
+        __m256d rho = _mm256_sub_pd(rho0, _mm256_mul_pd(rhoSlope, _mm256_add_pd(hv, padHeight)));
+        __m256d energyLoss = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(half, rho), Vv), Vv),
+            _mm256_add_pd(rocketDrag, _mm256_loadu_pd(&paddleDrag[i])));
+        energyLoss = _mm256_mul_pd(_mm256_mul_pd(energyLoss, _mm256_loadu_pd(&dragScale[i])), dh);
+        totalEnergy = _mm256_sub_pd(totalEnergy, energyLoss);
+        __m256d hNew = _mm256_add_pd(hv, dh);
+        __m256d potential = _mm256_mul_pd(mg, hNew);
+
+        __m256d climbs = _mm256_cmp_pd(totalEnergy, potential, _CMP_GT_OQ);
+        __m256d VClimb = _mm256_sqrt_pd(_mm256_div_pd(_mm256_mul_pd(two, _mm256_sub_pd(totalEnergy, potential)), massv));
+        __m256d hApogee = _mm256_add_pd(hNew, _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(half, Vv), Vv), gravity));
+        __m256d VNew = _mm256_blendv_pd(zero, VClimb, climbs);
+        hNew = _mm256_blendv_pd(hApogee, hNew, climbs);
+
+        __m256d timeStep = _mm256_div_pd(dh, VNew);
+        __m256d accel = _mm256_div_pd(_mm256_sub_pd(VNew, Vv), timeStep);
+        timeStep = _mm256_blendv_pd(_mm256_div_pd(dh, Vv), timeStep, climbs);
+        tv = _mm256_add_pd(tv, timeStep);
+
+        _mm256_storeu_pd(&h[i], _mm256_blendv_pd(hv, hNew, active));
+        _mm256_storeu_pd(&V[i], _mm256_blendv_pd(Vv, VNew, active));
+        _mm256_storeu_pd(&a[i], _mm256_blendv_pd(_mm256_loadu_pd(&a[i]), accel, active));
+        _mm256_storeu_pd(&currTime[i], _mm256_blendv_pd(_mm256_loadu_pd(&currTime[i]), tv, active));
+    }
+#endif
+
+    stepRange(i, paddedSize);
+}
+
+
+// Plain loop version of the step kernel, used for builds without AVX2 and for any lanes the vector
+// kernel did not cover
+void BatchSimulator::stepRange(int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (activeFlags[i] == 0) continue;
+
+        double totalEnergy = mass[i]*g*h[i] + 0.5*mass[i]*V[i]*V[i];
+        double energyLoss = 0.5*Simulator::getAirDensity(h[i])*V[i]*V[i]*(A_r*Cd_r +
+            paddleDrag[i])*dragScale[i] * heightStep;
+        totalEnergy -= energyLoss;
+        double hNew = h[i] + heightStep;
+        double VNew;
+        if (totalEnergy > (mass[i]*g*hNew)) VNew = sqrt(2*(totalEnergy - mass[i]*g*hNew)/mass[i]);
+        else
+        {
+            hNew += 0.5*V[i]*V[i]/g;
+            VNew = 0;
+        }
+
+        double timeStep = heightStep/VNew;
+        a[i] = (VNew - V[i]) / timeStep;
+        if (VNew == 0) timeStep = heightStep/V[i];
+        currTime[i] += timeStep;
+        h[i] = hNew;
+        V[i] = VNew;
+    }
+}
+
+
+// Runs the per-flight part of a step for every active flight: recording, the controller, the paddle
+// deployment rate limit and the apogee check, in the same order as Simulator::simulate(). Returns the
+// number of flights still climbing.
+int BatchSimulator::updatePaddles()
+{
+    int numActive = 0;
+    for (int i = 0; i < numFlights; i++)
+    {
+        if (activeFlags[i] == 0) continue;
+        numSteps[i]++;
+
+        records[i].addSample(currTime[i], h[i], V[i], a[i], alpha[i]);
+
+        double cmd_alpha;
+        if (fixedAngle[i] != -1) cmd_alpha = fixedAngle[i];
+        else if (controlPeriod <= 0 || currTime[i] >= t_c + controlTicks[i]*controlPeriod)
+        {
+            // with a control period the command is held until the first step of the next period
+            cmd_alpha = controllers[i]->calcAngle(currTime[i], h[i], V[i], a[i]);
+            if (controlPeriod > 0) controlTicks[i] = long(floor((currTime[i] - t_c)/controlPeriod)) + 1;
+        }
+        else cmd_alpha = heldCommand[i];
+        heldCommand[i] = cmd_alpha;
+
+        // enforce actual paddle deployment limitations
+        double previousAlpha = alpha[i];
+        if (cmd_alpha > alpha[i]) alpha[i] += PADDLE_DEPLOYMENT_RATE * (currTime[i] - lastTime[i]);
+        else if (cmd_alpha < alpha[i]) alpha[i] += -(PADDLE_DEPLOYMENT_RATE * (currTime[i] - lastTime[i]));
+        lastTime[i] = currTime[i];
+
+        if (alpha[i] >= MAX_PADDLE_ANGLE) alpha[i] = MAX_PADDLE_ANGLE;
+        else if (alpha[i] <= 0) alpha[i] = 0;
+
+        // sin() has no vector form here, so only recompute the drag when the paddles moved
+        if (alpha[i] != previousAlpha) paddleDrag[i] = Simulator::getPaddleDrag(alpha[i]);
+
+        if (V[i] > 0.1) numActive++;
+        else activeFlags[i] = 0;
+    }
+    return numActive;
+}
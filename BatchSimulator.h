@@ -0,0 +1,76 @@
+#ifndef BATCH_SIMULATOR_H
+#define BATCH_SIMULATOR_H
+
+/*
+File: BatchSimulator.h
+Author: Gerritt Graham
+Description: Simulates many independent flights in lock-step. The state of every flight is stored as
+structure-of-arrays and the energy balance is advanced for all flights at once with AVX-512 or AVX2
+kernels when the compiler targets them, or a plain loop otherwise. runprgm.sh and runbench.sh pass
+SIM_ARCH_FLAGS to the compiler, so e.g. SIM_ARCH_FLAGS=-mavx2 or -march=native selects a kernel.
+Flights that reach apogee are masked out while the rest continue. Paddle angles, controllers and
+records are handled per flight between steps. Each flight can have its own mass and drag scale, and
+the controllers can be run once per control period, so DispersionEngine flies its samples through
+it in fixed-size batches.
+
+Each flight uses the same fixed-step physics as Simulator. When the build does not contract
+multiplies and adds into FMA instructions (the default for x86-64), apogees and step counts match
+Simulator exactly. With FMA contraction (-mavx512f or -march=native) the two differ by rounding only,
+and apogees are documented to agree within 1e-9 m for both fixed-angle and controlled flights (the
+largest difference seen in testing was 6e-11 m).
+*/
+
+#include "consts.h"
+#include "Controller.h"
+#include "FlightRecord.h"
+#include "RecordWriter.h"
+#include <vector>
+#include <string>
+#include <cmath>
+
+using namespace std;
+
+class BatchSimulator
+{
+    public:
+    BatchSimulator(RecordPolicy recordPolicy = RECORD_NONE, double recordInterval = 0.1);
+    int addFlight(double h0, double V0, double alpha = -1, Controller* controller = nullptr);
+    void setDispersion(int flight, double massScale, double dragScale);
+    void setControlPeriod(double controlPeriod);
+    void clear();
+    void simulate();
+    int getNumFlights();
+    double getApogee(int flight);
+    int getNumSteps(int flight);
+    FlightRecord& getRecord(int flight);
+    void writeRecord(int flight, string fileSpec);
+    static string kernelName();
+
+    private:
+    static const int LANE_PADDING = 8;     //state arrays are padded to a multiple of the widest kernel
+
+    RecordPolicy recordPolicy;
+    double recordInterval;      //s
+    double heightStep;          //m
+    double controlPeriod;       //s, see Simulator::setControlPeriod()
+    int numFlights;
+
+    // structure-of-arrays flight state, one entry per flight plus padding
+    vector<double> h, V, a, currTime, lastTime, alpha, paddleDrag, fixedAngle;
+    vector<double> mass, dragScale;     //kg, and the scale of Simulator::setDispersion()
+    vector<double> activeFlags;     //1 while the flight is climbing, 0 once it reached apogee
+    vector<int> numSteps;
+    vector<long> controlTicks;      //control periods started so far
+    vector<double> heldCommand;     //rad, paddle command held until the next controller run
+    vector<Controller*> controllers;
+    vector<FlightRecord> records;
+
+    void stepAll();
+    void stepRange(int begin, int end);
+    int updatePaddles();
+    void padState();
+
+};
+
+
+#endif //BATCH_SIMULATOR_H
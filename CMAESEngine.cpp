@@ -0,0 +1,209 @@
+#include "CMAESEngine.h"
+
+CMAESEngine::CMAESEngine(int populationSize, double initialSigma)
+{
+    this->populationSize = populationSize;
+    this->initialSigma = initialSigma;
+    minSigma = 1e-6;
+}
+
+
+string CMAESEngine::getName()
+{
+    return "CMA-ES";
+}
+
+
+// Runs generations until the evaluation budget is spent or the step size collapses. Uses the standard
+// parameter settings for weights and learning rates.
+Solution CMAESEngine::optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+    Solution startSoln, int maxEvaluations, mt19937& rng)
+{
+    int lambda = (populationSize > 0) ? populationSize : 4 + int(3*log(double(N)));
+    int mu = lambda/2;
+
+    // recombination weights
+    vector<double> weights(mu);
+    for (int i = 0; i < mu; i++) weights.at(i) = log(mu + 0.5) - log(i + 1.0);
+    double weightSum = accumulate(weights.begin(), weights.end(), 0.0);
+    double weightSquares = 0;
+    for (int i = 0; i < mu; i++)
+    {
+        weights.at(i) /= weightSum;
+        weightSquares += weights.at(i)*weights.at(i);
+    }
+    double muEff = 1/weightSquares;
+
+    // learning rates
+    double cc = (4 + muEff/N)/(N + 4 + 2*muEff/N);
+    double cs = (muEff + 2)/(N + muEff + 5);
+    double c1 = 2/((N + 1.3)*(N + 1.3) + muEff);
+    double cmu = min(1 - c1, 2*(muEff - 2 + 1/muEff)/((N + 2)*(N + 2) + muEff));
+    double damps = 1 + 2*max(0.0, sqrt((muEff - 1)/(N + 1)) - 1) + cs;
+    double chiN = sqrt(double(N))*(1 - 1.0/(4*N) + 1.0/(21*N*N));
+
+    vector<double> mean = normalize(startSoln, bounds);
+    double sigma = initialSigma;
+    double C[N][N] = {{1,0,0},{0,1,0},{0,0,1}};
+    double B[N][N], D[N];
+    double pc[N] = {0,0,0}, ps[N] = {0,0,0};
+
+    Solution bestSoln = startSoln;
+    bool haveBest = false;
+    normal_distribution<double> gaussian(0, 1);
+    int numEvaluations = 0;
+
+    for (int generation = 0; numEvaluations + lambda <= maxEvaluations; generation++)
+    {
+        eigenDecompose(C, B, D);
+
+        // sample the population, redrawing samples that leave the bounds a few times
+        vector<vector<double>> samples(lambda, vector<double>(N));
+        for (int k = 0; k < lambda; k++)
+        {
+            for (int attempt = 0; attempt < 10; attempt++)
+            {
+                double z[N];
+                for (int i = 0; i < N; i++) z[i] = gaussian(rng);
+
+                bool inside = true;
+                for (int i = 0; i < N; i++)
+                {
+                    double y = 0;
+                    for (int j = 0; j < N; j++) y += B[i][j]*D[j]*z[j];
+                    samples.at(k).at(i) = mean.at(i) + sigma*y;
+                    if (samples.at(k).at(i) < 0 || samples.at(k).at(i) > 1) inside = false;
+                }
+                if (inside) break;
+            }
+            clampToUnitCube(samples.at(k));
+        }
+
+        vector<Solution> population(lambda);
+        for (int k = 0; k < lambda; k++) population.at(k) = denormalize(samples.at(k), bounds);
+        scoreBatch(population);
+        numEvaluations += lambda;
+
+        vector<int> order(lambda);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(),
+            [&](int a, int b) { return population.at(a).score < population.at(b).score; });
+        if (!haveBest || population.at(order.at(0)).score < bestSoln.score)
+        {
+            bestSoln.equals(population.at(order.at(0)));
+            haveBest = true;
+        }
+
+        // move the mean toward the best mu samples
+        vector<double> oldMean = mean;
+        for (int i = 0; i < N; i++)
+        {
+            mean.at(i) = 0;
+            for (int k = 0; k < mu; k++) mean.at(i) += weights.at(k)*samples.at(order.at(k)).at(i);
+        }
+        double yw[N];
+        for (int i = 0; i < N; i++) yw[i] = (mean.at(i) - oldMean.at(i))/sigma;
+
+        // step size path uses C^(-1/2) * yw = B D^-1 B^T yw
+        double BTyw[N], invSqrtCyw[N];
+        for (int j = 0; j < N; j++)
+        {
+            BTyw[j] = 0;
+            for (int i = 0; i < N; i++) BTyw[j] += B[i][j]*yw[i];
+            BTyw[j] /= D[j];
+        }
+        for (int i = 0; i < N; i++)
+        {
+            invSqrtCyw[i] = 0;
+            for (int j = 0; j < N; j++) invSqrtCyw[i] += B[i][j]*BTyw[j];
+        }
+        double psNorm = 0;
+        for (int i = 0; i < N; i++)
+        {
+            ps[i] = (1 - cs)*ps[i] + sqrt(cs*(2 - cs)*muEff)*invSqrtCyw[i];
+            psNorm += ps[i]*ps[i];
+        }
+        psNorm = sqrt(psNorm);
+
+        bool hsig = psNorm/sqrt(1 - pow(1 - cs, 2*(generation + 1)))/chiN < 1.4 + 2.0/(N + 1);
+        for (int i = 0; i < N; i++) pc[i] = (1 - cc)*pc[i] + (hsig ? sqrt(cc*(2 - cc)*muEff) : 0)*yw[i];
+
+        // rank-one and rank-mu covariance updates
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                double rankMu = 0;
+                for (int k = 0; k < mu; k++)
+                {
+                    const vector<double>& x = samples.at(order.at(k));
+                    rankMu += weights.at(k)*(x.at(i) - oldMean.at(i))*(x.at(j) - oldMean.at(j))/(sigma*sigma);
+                }
+                double rankOne = pc[i]*pc[j] + (hsig ? 0 : cc*(2 - cc)*C[i][j]);
+                C[i][j] = (1 - c1 - cmu)*C[i][j] + c1*rankOne + cmu*rankMu;
+            }
+        }
+
+        sigma *= exp((cs/damps)*(psNorm/chiN - 1));
+        double maxD = *max_element(D, D + N);
+        if (sigma*maxD < minSigma) break;
+    }
+
+    return bestSoln;
+}
+
+
+// Cyclic Jacobi eigenvalue decomposition of the symmetric matrix C. The columns of B are the
+// eigenvectors and D holds the square roots of the eigenvalues, so C = B diag(D^2) B^T.
+void CMAESEngine::eigenDecompose(const double C[N][N], double B[N][N], double D[N])
+{
+    double A[N][N];
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            A[i][j] = C[i][j];
+            B[i][j] = (i == j) ? 1 : 0;
+        }
+    }
+
+    for (int sweep = 0; sweep < 50; sweep++)
+    {
+        double offDiagonal = 0;
+        for (int i = 0; i < N; i++) for (int j = i + 1; j < N; j++) offDiagonal += A[i][j]*A[i][j];
+        if (offDiagonal < 1e-30) break;
+
+        for (int p = 0; p < N; p++)
+        {
+            for (int q = p + 1; q < N; q++)
+            {
+                if (A[p][q] == 0) continue;
+                double theta = (A[q][q] - A[p][p])/(2*A[p][q]);
+                double t = ((theta >= 0) ? 1 : -1)/(abs(theta) + sqrt(theta*theta + 1));
+                double c = 1/sqrt(t*t + 1), s = t*c;
+
+                for (int k = 0; k < N; k++)
+                {
+                    double akp = A[k][p], akq = A[k][q];
+                    A[k][p] = c*akp - s*akq;
+                    A[k][q] = s*akp + c*akq;
+                }
+                for (int k = 0; k < N; k++)
+                {
+                    double apk = A[p][k], aqk = A[q][k];
+                    A[p][k] = c*apk - s*aqk;
+                    A[q][k] = s*apk + c*aqk;
+                }
+                for (int k = 0; k < N; k++)
+                {
+                    double bkp = B[k][p], bkq = B[k][q];
+                    B[k][p] = c*bkp - s*bkq;
+                    B[k][q] = s*bkp + c*bkq;
+                }
+            }
+        }
+    }
+
+    // guard against eigenvalues lost to rounding
+    for (int i = 0; i < N; i++) D[i] = sqrt(max(A[i][i], 1e-20));
+}
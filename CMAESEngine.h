@@ -0,0 +1,42 @@
+#ifndef CMAES_ENGINE_H
+#define CMAES_ENGINE_H
+
+/*
+File: CMAESEngine.h
+Author: Gerritt Graham
+Description: Covariance matrix adaptation evolution strategy (CMA-ES) for tuning the PID gains. Each
+generation samples a whole population from a multivariate normal distribution and scores it as one
+batch, so the flights of a generation run in parallel. The mean moves toward the best half of the
+population and the covariance and step size adapt to the shape of the objective, so no step sizes
+have to be hand tuned. Samples that fall outside the bounds are drawn again a few times and then
+clamped onto the bounds.
+*/
+
+#include "OptimizerEngine.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+class CMAESEngine : public OptimizerEngine
+{
+    public:
+    CMAESEngine(int populationSize = 0, double initialSigma = 0.3);
+    string getName();
+    Solution optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+        Solution startSoln, int maxEvaluations, mt19937& rng);
+
+    private:
+    static const int N = 3;     //kp, ki, kd
+    int populationSize;         //0 picks the standard 4 + 3 ln(N)
+    double initialSigma;        //initial step size in normalized units
+    double minSigma;            //stops once the search distribution is this narrow
+
+    static void eigenDecompose(const double C[N][N], double B[N][N], double D[N]);
+
+};
+
+
+#endif //CMAES_ENGINE_H
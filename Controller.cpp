@@ -14,75 +14,101 @@ Controller::Controller(double kp, double ki, double kd, double h0, double V0)
     ref_alpha = 0;
     cmd_alpha = 0;
 
+    referenceMode = REFERENCE_SNAP;
+    numNeighbours = 4;
     loadData();  
 }
 
 
-// Loads data for the reference trajectory from the file specified by dataFile. 
-void Controller::loadData()
+// Selects how the reference trajectory is chosen and reloads it. In REFERENCE_BLEND mode the
+// numNeighbours trajectories closest to the MECO conditions are blended, 2 to 4 works well.
+void Controller::setReferenceMode(ReferenceMode mode, int numNeighbours)
 {
-    string dataFile = selectFile();
-    
-    // Open input file stream
-    ifstream reader(dataFile);
-    if(!reader.is_open())
+    referenceMode = mode;
+    this->numNeighbours = max(numNeighbours, 1);
+    loadData();
+}
+
+
+// Prepares the controller for a new flight with new gains and MECO conditions without building a new
+// object. The reference trajectory is only selected again if the MECO conditions changed.
+void Controller::reset(double kp, double ki, double kd, double h0, double V0)
+{
+    this->kp = kp;
+    this->ki = ki;
+    this->kd = kd;
+
+    ref_alpha = 0;
+    cmd_alpha = 0;
+
+    if (h0 != mecoHeight || V0 != mecoVelocity)
     {
-        cout << "Data file failed to open in Controller::loadData()." << endl;
+        mecoHeight = h0;
+        mecoVelocity = V0;
+        loadData();
     }
+    else timeCursor = 0;
+}
 
-    string line;
-    for(int i = 0; i < REF_HEADER_SIZE; i++) getline(reader, line);  //skip header
 
-    // read each line of the data file
-    while(getline(reader, line))
+// Borrows the selected reference trajectory from the process-wide ReferenceStore, or blends the
+// nearest ones using the store's spatial index. The files are only read from disk the first time
+// any Controller asks for them.
+void Controller::loadData()
+{
+    timeCursor = 0;
+    if (referenceMode == REFERENCE_BLEND)
     {
-        double t1, h1, V1, a1;
-        stringstream parser(line);
-        parser >> t1 >> h1 >> V1 >> a1;
-        refTimes.push_back(t1);
-        refHeights.push_back(h1);
-        refVelocities.push_back(V1);
-        refAccels.push_back(a1);
+        reference = ReferenceStore::instance().getSelector()->blend(mecoHeight, mecoVelocity, numNeighbours);
+        if (reference)
+        {
+            selectedTrajectoryNum = reference->trajectoryNum;
+            return;
+        }
+        cout << "Index file is empty in Controller::loadData()." << endl;
     }
+
+    selectedTrajectoryNum = selectTrajectory();
+    reference = ReferenceStore::instance().getTrajectory(selectedTrajectoryNum);
 }
 
 
-string Controller::selectFile()
+// Picks the reference trajectory whose MECO velocity is closest to this controller's, among the
+// index entries within HEIGHT_THRESHOLD of its MECO height. Falls back to the first entry.
+int Controller::selectTrajectory()
 {
-    string selectedFileName;
-
-    ifstream reader(REF_DIRECTORY + INDEX_FILE_NAME);
-    if(!reader.is_open())
+    shared_ptr<const vector<ReferenceIndexEntry>> index = ReferenceStore::instance().getIndex();
+    if (index->empty())
     {
-        cout << "Index file failed to open in Controller::loadData()." << endl;
+        cout << "Index file is empty in Controller::selectTrajectory()." << endl;
+        return -1;
     }
 
-    double selectedHeight = 0, selectedVelocity = 0;
     double HEIGHT_THRESHOLD = 40;   //m
-    double currHeight, currVelocity;
-    string filename;
+    const ReferenceIndexEntry* selected = &index->at(0);
 
-    reader >> currHeight >> currVelocity >> filename;
-    selectedHeight = currHeight;
-    selectedVelocity = currVelocity;
-    selectedFileName = filename;
-
-    while(reader >> currHeight)
+    for (int i = 1; i < index->size(); i++)
     {
-        reader >> currVelocity >> filename;
-        if (abs(mecoVelocity-currVelocity) < abs(mecoVelocity-selectedVelocity) 
-            && abs(mecoHeight-currHeight) < HEIGHT_THRESHOLD)
+        const ReferenceIndexEntry& curr = index->at(i);
+        if (abs(mecoVelocity-curr.velocity) < abs(mecoVelocity-selected->velocity) 
+            && abs(mecoHeight-curr.height) < HEIGHT_THRESHOLD)
             {
-                selectedHeight = currHeight;
-                selectedVelocity = currVelocity;
-                selectedFileName = filename;
+                selected = &curr;
             }
     }
 
-    string fileNumber = selectedFileName.substr(REF_FILE_BASE.length(), (selectedFileName.find(".") - REF_FILE_BASE.length()));
-    selectedTrajectoryNum = stoi(fileNumber);
-    
-    return REF_DIRECTORY + selectedFileName;
+    return selected->trajectoryNum;
+}
+
+
+// Hashes the reference data in the ReferenceStore and how a reference is chosen from it, continuing
+// from hash. Controllers with equal hashes follow the same reference from given MECO conditions.
+uint64_t Controller::hashSettings(uint64_t hash)
+{
+    int settings[] = {int(referenceMode), numNeighbours};
+
+    hash = hashBytes(settings, sizeof(settings), hash);
+    return ReferenceStore::instance().fingerprint(hash);
 }
 
 
@@ -90,17 +116,23 @@ string Controller::selectFile()
 // current values of the rocket in real time, not the optimal reference values
 double Controller::calcAngle(double currTime, double currHeight, double currVelocity, double currAccel)
 { 
+    INSTRUMENT_TIMER(TIME_CONTROLLER);
+    INSTRUMENT_COUNT(COUNT_CONTROLLER_CALLS, 1);
     ref_alpha = 0;
+    if (reference->numSamples == 0) return 0;   //no reference to follow
+
+    double refHeight, refVelocity, refAccel;
+    interpolateReference(currTime, refHeight, refVelocity, refAccel);
 
-    double error_h = currHeight - getRefHeight(currTime);
+    double error_h = currHeight - refHeight;
     
-    double error_v = currVelocity - getRefVelocity(currTime);
-    double error_a = currAccel - getRefAccel(currTime);
+    double error_v = currVelocity - refVelocity;
+    double error_a = currAccel - refAccel;
     
     //Actual PID Magic
     //Trigger band antiwindup scheme (trying to improve robustnesss)
-    if (abs(error_v) > getRefVelocity(currTime) * .15) cmd_alpha = ref_alpha + (error_v * kp) - (error_a * kd);
-    else if (abs(error_v) <= getRefVelocity(currTime) * .15) cmd_alpha = ref_alpha + (error_v * kp) + (error_h * ki) - (error_a * kd); 
+    if (abs(error_v) > refVelocity * .15) cmd_alpha = ref_alpha + (error_v * kp) - (error_a * kd);
+    else if (abs(error_v) <= refVelocity * .15) cmd_alpha = ref_alpha + (error_v * kp) + (error_h * ki) - (error_a * kd); 
 
 
     //This is our saturation limits so we dont break things cause that would cause mucho problems
@@ -127,64 +159,63 @@ std::vector<std::string> Controller::split(const std::string& text, char delimit
 }
 
 
-// Find the closest reference time index to the specified time
+// Find the first reference time index above the specified time. Simulation time only moves forward
+// between calls, so the search continues from where the last call left off and usually moves by
+// at most one sample. If time moves backward a binary search repositions the cursor.
 int Controller::findTimeIndex(double t)
 {
-    for (int i = 0; i < refTimes.size(); i++)
+    const double* refTimes = reference->times;
+    int numSamples = reference->numSamples;
+
+    if (timeCursor > 0 && refTimes[timeCursor-1] > t)
     {
-        if(refTimes.at(i) > t) return i;  //return time index above the specified time value  
+        timeCursor = upper_bound(refTimes, refTimes + numSamples, t) - refTimes;
     }
-    //cout << "Didn't find index" << endl;
-    return refTimes.size()-1;  //index was not found
-}
-
+    while (timeCursor < numSamples && refTimes[timeCursor] <= t) timeCursor++;
 
-// Calculate reference height at specified time using linear interpolation
-double Controller::getRefHeight(double t)
-{
-    unsigned int upperBound = findTimeIndex(t);
-    if (upperBound == 0) return refHeights.at(0);
-
-    unsigned int lowerBound = upperBound - 1;
-    double refHeight = refHeights.at(lowerBound) + 
-        (t-refTimes.at(lowerBound)) * (refHeights.at(upperBound)-refHeights.at(lowerBound)) /
-        (refTimes.at(upperBound)-refTimes.at(lowerBound));
-    
-    return refHeight;
+    if (timeCursor < numSamples) return timeCursor;  //return time index above the specified time value
+    return numSamples-1;  //index was not found
 }
 
 
-// Calculate reference velocity at specified time using linear interpolation
-double Controller::getRefVelocity(double t)
+// Calculate reference height, velocity and acceleration at the specified time using linear
+// interpolation. The bracketing interval is found once and shared by all three channels.
+void Controller::interpolateReference(double t, double& refHeight, double& refVelocity, double& refAccel)
 {
+    const double* refTimes = reference->times;
+    const double* refHeights = reference->heights;
+    const double* refVelocities = reference->velocities;
+    const double* refAccels = reference->accels;
+
     unsigned int upperBound = findTimeIndex(t);
-    if (upperBound == 0) return refVelocities.at(0);
+    if (upperBound == 0)
+    {
+        refHeight = refHeights[0];
+        refVelocity = refVelocities[0];
+        refAccel = refAccels[0];
+        return;
+    }
 
     unsigned int lowerBound = upperBound - 1;
-    double refVelocity = refVelocities.at(lowerBound) + 
-        (t-refTimes.at(lowerBound)) * (refVelocities.at(upperBound)-refVelocities.at(lowerBound)) /
-        (refTimes.at(upperBound)-refTimes.at(lowerBound));
-    
-    return refVelocity;
+    double dt = t-refTimes[lowerBound];
+    double intervalLength = refTimes[upperBound]-refTimes[lowerBound];
+    refHeight = refHeights[lowerBound] + 
+        dt * (refHeights[upperBound]-refHeights[lowerBound]) / intervalLength;
+    refVelocity = refVelocities[lowerBound] + 
+        dt * (refVelocities[upperBound]-refVelocities[lowerBound]) / intervalLength;
+    refAccel = refAccels[lowerBound] + 
+        dt * (refAccels[upperBound]-refAccels[lowerBound]) / intervalLength;
 }
 
 
-// Calculate reference accleration at specified time using linear interpolation
-double Controller::getRefAccel(double t)
+int Controller::getTrajectoryNum()
 {
-    unsigned int upperBound = findTimeIndex(t);
-    if (upperBound == 0) return refAccels.at(0);
-
-    unsigned int lowerBound = upperBound - 1;
-    double refAccel = refAccels.at(lowerBound) + 
-        (t-refTimes.at(lowerBound)) * (refAccels.at(upperBound)-refAccels.at(lowerBound)) /
-        (refTimes.at(upperBound)-refTimes.at(lowerBound));
-    
-    return refAccel;
+    return selectedTrajectoryNum;
 }
 
 
-int Controller::getTrajectoryNum()
+// Returns the reference trajectory this controller is following
+shared_ptr<const ReferenceTrajectory> Controller::getReference()
 {
-    return selectedTrajectoryNum;
+    return reference;
 }
\ No newline at end of file
@@ -10,36 +10,53 @@ formula to calculate a paddle deployment angle at each time step.
 */
 
 #include "consts.h"
+#include "ReferenceStore.h"
+#include "ReferenceSelector.h"
+#include "Instrumentation.h"
 #include <vector>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <memory>
+#include <algorithm>
 
 using namespace std;
 
+// How the reference trajectory is chosen from the MECO conditions
+enum ReferenceMode
+{
+    REFERENCE_SNAP,     //original rule, follows a single trajectory from the index
+    REFERENCE_BLEND     //blends the nearest trajectories into one interpolated reference
+};
+
 class Controller
 {
     public:
     Controller(double kp, double ki, double kd, double h0, double V0);
+    void reset(double kp, double ki, double kd, double h0, double V0);
     double calcAngle(double currTime, double currHeight, double currVelocity, double currAccel);
     int getTrajectoryNum();
+    void setReferenceMode(ReferenceMode mode, int numNeighbours = 4);
+    shared_ptr<const ReferenceTrajectory> getReference();
+    uint64_t hashSettings(uint64_t hash = HASH_SEED);
 
     private:
     double kp, ki, kd;
     double ref_alpha, cmd_alpha;
     double mecoHeight, mecoVelocity;
-    vector<double> refTimes, refHeights, refVelocities, refAccels;
-    int selectedTrajectoryNum;
+    shared_ptr<const ReferenceTrajectory> reference;   //borrowed from the ReferenceStore
+    int selectedTrajectoryNum;      //-1 for a blended reference
+    ReferenceMode referenceMode;
+    int numNeighbours;              //trajectories blended in REFERENCE_BLEND mode
+    int timeCursor;     //reference index returned by the last findTimeIndex() call
     
     int findTimeIndex(double t);
-    double getRefHeight(double t);
-    double getRefVelocity(double t);
-    double getRefAccel(double t);
+    void interpolateReference(double t, double& refHeight, double& refVelocity, double& refAccel);
 
     void loadData();
-    string selectFile();
+    int selectTrajectory();
     vector<string> split(const string& s, char delimiter);
 
 };
@@ -0,0 +1,283 @@
+#include "DispersionEngine.h"
+
+double Dispersion::sample(mt19937& rng) const
+{
+    if (type == DISTRIBUTION_UNIFORM) return uniform_real_distribution<double>(center - spread, center + spread)(rng);
+    if (type == DISTRIBUTION_NORMAL) return normal_distribution<double>(center, spread)(rng);
+    return center;
+}
+
+
+StreamingStats::StreamingStats(double histogramMin, double histogramMax, int numBins)
+    : bins(numBins, 0)
+{
+    this->histogramMin = histogramMin;
+    this->histogramMax = histogramMax;
+    binWidth = (histogramMax - histogramMin) / numBins;
+    count = 0;
+    mean = sumSquares = 0;
+    minValue = numeric_limits<double>::infinity();
+    maxValue = -numeric_limits<double>::infinity();
+    underflow = overflow = 0;
+}
+
+
+// Adds one value, updating the mean and variance with Welford's method
+void StreamingStats::add(double value)
+{
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    sumSquares += delta * (value - mean);
+    minValue = min(minValue, value);
+    maxValue = max(maxValue, value);
+
+    if (value < histogramMin) underflow++;
+    else if (value >= histogramMax) overflow++;
+    else bins.at(min(int((value - histogramMin) / binWidth), int(bins.size()) - 1))++;
+}
+
+
+// Combines the statistics of another stream into this one (Chan et al.). Both must use the same
+// histogram range and number of bins.
+void StreamingStats::merge(const StreamingStats& other)
+{
+    if (other.count == 0) return;
+    long total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    sumSquares += other.sumSquares + delta*delta * (double(count) * other.count / total);
+    count = total;
+    minValue = min(minValue, other.minValue);
+    maxValue = max(maxValue, other.maxValue);
+
+    for (int i = 0; i < bins.size(); i++) bins.at(i) += other.bins.at(i);
+    underflow += other.underflow;
+    overflow += other.overflow;
+}
+
+
+long StreamingStats::getCount()
+{
+    return count;
+}
+
+
+double StreamingStats::getMean()
+{
+    return mean;
+}
+
+
+// Sample variance, 0 with fewer than two values
+double StreamingStats::getVariance()
+{
+    return (count > 1) ? sumSquares / (count - 1) : 0;
+}
+
+
+double StreamingStats::getStdDev()
+{
+    return sqrt(getVariance());
+}
+
+
+double StreamingStats::getMin()
+{
+    return minValue;
+}
+
+
+double StreamingStats::getMax()
+{
+    return maxValue;
+}
+
+
+// Estimates the value below which a fraction level of the values lie, interpolating linearly within
+// the histogram bin that holds it. Values outside the histogram are assumed to be spread evenly
+// between the histogram edge and the extreme value, so quantiles there are rough.
+double StreamingStats::quantile(double level)
+{
+    if (count == 0) return 0;
+    double target = level * count;
+
+    auto interpolate = [&](double binStart, double binEnd, long binCount, double countBefore)
+    {
+        double fraction = (binCount > 0) ? (target - countBefore) / binCount : 0;
+        return min(max(binStart + fraction*(binEnd - binStart), minValue), maxValue);
+    };
+
+    double cumulative = underflow;
+    if (target <= cumulative) return interpolate(minValue, histogramMin, underflow, 0);
+    for (int i = 0; i < bins.size(); i++)
+    {
+        if (target <= cumulative + bins.at(i))
+        {
+            double binStart = histogramMin + i*binWidth;
+            return interpolate(binStart, binStart + binWidth, bins.at(i), cumulative);
+        }
+        cumulative += bins.at(i);
+    }
+    return interpolate(histogramMax, maxValue, overflow, cumulative);
+}
+
+
+// Writes the histogram as one "bin start, bin end, count" line per bin, with the underflow and
+// overflow counts in the header. Returns false if the file cannot be opened.
+bool StreamingStats::writeHistogram(const string& filename)
+{
+    ofstream writer(filename);
+    if (!writer.is_open())
+    {
+        cout << "Histogram file did not open in StreamingStats::writeHistogram()." << endl;
+        return false;
+    }
+
+    writer << "Samples: " << count << ", below range: " << underflow << ", above range: " << overflow << endl;
+    writer << "Bin start, Bin end, Count" << endl;
+    for (int i = 0; i < bins.size(); i++)
+    {
+        writer << histogramMin + i*binWidth << " " << histogramMin + (i + 1)*binWidth << " " << bins.at(i) << endl;
+    }
+    return true;
+}
+
+
+DispersionEngine::DispersionEngine(int numThreads)
+{
+    setNumThreads(numThreads);
+    model = defaultModel();
+    kp = ki = kd = 0;
+    seed = 1;
+    controlPeriod = 0;
+    histogramMin = -500;   //m of apogee error
+    histogramMax = 500;
+    numBins = 1000;
+}
+
+
+void DispersionEngine::setModel(const DispersionModel& model)
+{
+    this->model = model;
+}
+
+
+void DispersionEngine::setGains(double kp, double ki, double kd)
+{
+    this->kp = kp;
+    this->ki = ki;
+    this->kd = kd;
+}
+
+
+void DispersionEngine::setSeed(unsigned int seed)
+{
+    this->seed = seed;
+}
+
+
+// Sets the range (m of apogee error) and resolution of the histogram quantiles are read from
+void DispersionEngine::setHistogram(double histogramMin, double histogramMax, int numBins)
+{
+    this->histogramMin = histogramMin;
+    this->histogramMax = histogramMax;
+    this->numBins = numBins;
+}
+
+
+// Sets the number of worker threads. A value of 0 or less uses every core.
+void DispersionEngine::setNumThreads(int numThreads)
+{
+    this->numThreads = resolveThreadCount(numThreads);
+}
+
+
+// Runs the controller once per controlPeriod (s) in every flight, like the flight computer. The
+// default of 0 runs it after every step.
+void DispersionEngine::setControlPeriod(double controlPeriod)
+{
+    this->controlPeriod = controlPeriod;
+}
+
+
+// Flies numSamples dispersed flights and returns the statistics of their apogee error (m, apogee
+// minus TARGET_APOGEE). The controller is reset to each sample's MECO conditions, as it would be by a
+// measured MECO state in flight. The flights of a chunk are flown BATCH_SIZE at a time in a
+// BatchSimulator, which gives the same apogees as flying them one at a time with Simulator.
+StreamingStats DispersionEngine::run(long numSamples)
+{
+    int numChunks = min(long(NUM_CHUNKS), max(numSamples, 1L));
+    int numWorkers = min(numThreads, numChunks);
+    vector<StreamingStats> chunkStats(numChunks, StreamingStats(histogramMin, histogramMax, numBins));
+
+    // every flight in a batch needs its own controller, so each worker keeps BATCH_SIZE of them
+    vector<unique_ptr<BatchSimulator>> batches;
+    vector<vector<unique_ptr<Controller>>> controllers(numWorkers);
+    for (int w = 0; w < numWorkers; w++)
+    {
+        batches.emplace_back(new BatchSimulator(RECORD_NONE));
+        batches.back()->setControlPeriod(controlPeriod);
+    }
+
+    parallelFor(numChunks, numWorkers, [&](int chunk, int workerNum)
+    {
+        BatchSimulator& batch = *batches.at(workerNum);
+        vector<unique_ptr<Controller>>& pool = controllers.at(workerNum);
+        long first = numSamples * chunk / numChunks;
+        long last = numSamples * (chunk + 1) / numChunks;
+
+        for (long sliceStart = first; sliceStart < last; sliceStart += BATCH_SIZE)
+        {
+            batch.clear();
+            for (long i = sliceStart; i < min(sliceStart + BATCH_SIZE, last); i++)
+            {
+                seed_seq sampleSeed{seed, unsigned(i), unsigned(i >> 32)};
+                mt19937 rng(sampleSeed);
+                double h0 = mecoHeight + model.height.sample(rng);
+                double V0 = mecoVelocity + model.velocity.sample(rng);
+                double massScale = model.massScale.sample(rng);
+                double dragScale = model.dragScale.sample(rng);
+
+                int flight = batch.getNumFlights();
+                if (flight == pool.size()) pool.emplace_back(new Controller(kp, ki, kd, h0, V0));
+                else pool.at(flight)->reset(kp, ki, kd, h0, V0);
+                batch.addFlight(h0, V0, -1, pool.at(flight).get());
+                batch.setDispersion(flight, massScale, dragScale);
+            }
+            batch.simulate();
+
+            for (int flight = 0; flight < batch.getNumFlights(); flight++)
+            {
+                chunkStats.at(chunk).add(batch.getApogee(flight) - TARGET_APOGEE);
+            }
+        }
+    });
+
+    StreamingStats stats = chunkStats.at(0);
+    for (int c = 1; c < numChunks; c++) stats.merge(chunkStats.at(c));
+    return stats;
+}
+
+
+void DispersionEngine::printSummary(StreamingStats& stats)
+{
+    cout << "Monte Carlo dispersion, apogee error over " << stats.getCount() << " flights (m):" << endl;
+    cout << "mean: " << stats.getMean() << ", std dev: " << stats.getStdDev() << ", min: " << stats.getMin()
+        << ", max: " << stats.getMax() << endl;
+    cout << "1%: " << stats.quantile(0.01) << ", 5%: " << stats.quantile(0.05) << ", 50%: " << stats.quantile(0.5)
+        << ", 95%: " << stats.quantile(0.95) << ", 99%: " << stats.quantile(0.99) << endl;
+}
+
+
+// MECO spread of the same order as the offsets used by GainOptimizer::findPerturbationSolution(),
+// with a 2% mass and 5% drag uncertainty
+DispersionModel DispersionEngine::defaultModel()
+{
+    DispersionModel defaults;
+    defaults.height = Dispersion(DISTRIBUTION_NORMAL, 0, 20);       //m
+    defaults.velocity = Dispersion(DISTRIBUTION_NORMAL, 0, 10);     //m/s
+    defaults.massScale = Dispersion(DISTRIBUTION_NORMAL, 1, 0.02);
+    defaults.dragScale = Dispersion(DISTRIBUTION_NORMAL, 1, 0.05);
+    return defaults;
+}
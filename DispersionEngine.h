@@ -0,0 +1,119 @@
+#ifndef DISPERSION_ENGINE_H
+#define DISPERSION_ENGINE_H
+
+/*
+File: DispersionEngine.h
+Author: Gerritt Graham
+Description: Monte Carlo dispersion analysis of a PID controller. Each sample draws a MECO height and
+velocity, and optionally a mass and drag scale, from configurable distributions and flies the rocket
+from there with the given gains. The apogee error of every flight is folded into streaming statistics
+(mean and variance by Welford's method, extremes, and a fixed-bin histogram for quantiles), so memory
+use does not grow with the number of samples. Samples are split into a fixed number of chunks spread
+over the worker threads, and each chunk is flown by a BatchSimulator in batches of BATCH_SIZE (64)
+flights, so each worker holds at most that many flights and controllers at once. Every sample has its
+own random generator seeded from (seed, sample index) and chunk statistics are merged in chunk order,
+so results only depend on the seed and not on the number of threads.
+*/
+
+#include "consts.h"
+#include "Simulator.h"
+#include "BatchSimulator.h"
+#include "Controller.h"
+#include "ParallelFor.h"
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+enum DistributionType
+{
+    DISTRIBUTION_NONE,      //always center
+    DISTRIBUTION_UNIFORM,   //uniform within spread either side of center
+    DISTRIBUTION_NORMAL     //mean center, standard deviation spread
+};
+
+// Distribution of one dispersed quantity
+struct Dispersion
+{
+    DistributionType type;
+    double center, spread;
+
+    Dispersion(DistributionType type = DISTRIBUTION_NONE, double center = 0, double spread = 0)
+    {
+        this->type = type;
+        this->center = center;
+        this->spread = spread;
+    }
+    double sample(mt19937& rng) const;
+};
+
+// Everything that is dispersed in a Monte Carlo run
+struct DispersionModel
+{
+    Dispersion height, velocity;        //offsets from mecoHeight (m) and mecoVelocity (m/s)
+    Dispersion massScale, dragScale;    //see Simulator::setDispersion(), centered on 1 when used
+};
+
+// Count, mean, variance, extremes and histogram of a stream of values in constant memory. Values
+// outside the histogram range are counted as underflow or overflow.
+class StreamingStats
+{
+    public:
+    StreamingStats(double histogramMin = -500, double histogramMax = 500, int numBins = 1000);
+    void add(double value);
+    void merge(const StreamingStats& other);
+    long getCount();
+    double getMean();
+    double getVariance();
+    double getStdDev();
+    double getMin();
+    double getMax();
+    double quantile(double level);
+    bool writeHistogram(const string& filename);
+
+    private:
+    long count;
+    double mean, sumSquares;    //sumSquares is the sum of squared differences from the mean
+    double minValue, maxValue;
+    double histogramMin, histogramMax, binWidth;
+    vector<long> bins;
+    long underflow, overflow;
+
+};
+
+class DispersionEngine
+{
+    public:
+    DispersionEngine(int numThreads = 1);
+    void setModel(const DispersionModel& model);
+    void setGains(double kp, double ki, double kd);
+    void setSeed(unsigned int seed);
+    void setHistogram(double histogramMin, double histogramMax, int numBins);
+    void setNumThreads(int numThreads);
+    void setControlPeriod(double controlPeriod);
+    StreamingStats run(long numSamples);
+    static void printSummary(StreamingStats& stats);
+    static DispersionModel defaultModel();
+
+    private:
+    static const int NUM_CHUNKS = 256;
+    static const int BATCH_SIZE = 64;      //flights flown together by a worker
+
+    int numThreads;
+    DispersionModel model;
+    double kp, ki, kd;
+    unsigned int seed;
+    double controlPeriod;       //s, see Simulator::setControlPeriod()
+    double histogramMin, histogramMax;
+    int numBins;
+
+};
+
+
+#endif //DISPERSION_ENGINE_H
@@ -0,0 +1,101 @@
+#include "ErrorAccumulator.h"
+
+ErrorAccumulator::ErrorAccumulator(shared_ptr<const ReferenceTrajectory> reference)
+{
+    cutoff = numeric_limits<double>::infinity();
+    setReference(reference);
+}
+
+
+// Sets the trajectory to score against and clears the running total
+void ErrorAccumulator::setReference(shared_ptr<const ReferenceTrajectory> reference)
+{
+    this->reference = reference;
+    reset();
+}
+
+
+// Clears the running total so a new flight can be scored against the same reference
+void ErrorAccumulator::reset()
+{
+    refIndex = 0;
+    errorVal = 0;
+    prevHeight = 0;
+    heldHeight = 0;
+    hasSamples = false;
+    finished = false;
+}
+
+
+// Adds one simulated sample. Every reference sample whose time falls before t is compared to the
+// previous simulated sample, which is the last one at or before the reference time.
+void ErrorAccumulator::addSample(double t, double h)
+{
+    if (!reference) return;
+
+    if (!hasSamples)
+    {
+        prevHeight = h;
+        heldHeight = h;
+        hasSamples = true;
+        return;
+    }
+
+    const double* refTimes = reference->times;
+    const double* refHeights = reference->heights;
+    int numRefSamples = reference->numSamples;
+    while (refIndex < numRefSamples && refTimes[refIndex] < t)
+    {
+        heldHeight = prevHeight;
+        errorVal += abs(refHeights[refIndex] - heldHeight) / (numRefSamples - refIndex);
+        refIndex++;
+    }
+    prevHeight = h;
+}
+
+
+// Scores the reference samples that fall after the end of the flight against the last matched
+// height and returns the total error. Further calls return the same total.
+double ErrorAccumulator::finish()
+{
+    if (!reference || finished) return errorVal;
+
+    const double* refHeights = reference->heights;
+    int numRefSamples = reference->numSamples;
+    for (; refIndex < numRefSamples; refIndex++)
+    {
+        errorVal += abs(refHeights[refIndex] - heldHeight) / (numRefSamples - refIndex);
+    }
+    finished = true;
+    return errorVal;
+}
+
+
+// Returns the error accumulated so far. Only final once finish() has been called.
+double ErrorAccumulator::getError()
+{
+    return errorVal;
+}
+
+
+// Sets the error above which exceedsCutoff() reports that the flight cannot score well enough to
+// matter. Infinity, the default, never cuts a flight short. Kept across reset().
+void ErrorAccumulator::setCutoff(double cutoff)
+{
+    this->cutoff = cutoff;
+}
+
+
+// Returns true once the error so far, and so the final error, is above the cutoff
+bool ErrorAccumulator::exceedsCutoff()
+{
+    return errorVal > cutoff;
+}
+
+
+// Returns the last height of the reference trajectory, or 0 if there is none
+double ErrorAccumulator::getReferenceApogee()
+{
+    if (!reference || reference->numSamples == 0) return 0;
+    return reference->heights[reference->numSamples - 1];
+}
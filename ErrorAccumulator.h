@@ -0,0 +1,47 @@
+#ifndef ERROR_ACCUMULATOR_H
+#define ERROR_ACCUMULATOR_H
+
+/*
+File: ErrorAccumulator.h
+Author: Gerritt Graham
+Description: Scores a flight against a reference trajectory while the flight is being simulated. Each
+reference sample is compared to the last simulated height at or before its time stamp, weighted by
+1/(N-i) so later samples count more, exactly like the original post-flight Simulator::calcError.
+Samples must be added in increasing time order. Every term of the error is positive, so the total so
+far is a lower bound on the final score. A flight can therefore be abandoned as soon as the total
+passes a cutoff the caller is not interested in beating.
+*/
+
+#include "ReferenceStore.h"
+#include <memory>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+class ErrorAccumulator
+{
+    public:
+    ErrorAccumulator(shared_ptr<const ReferenceTrajectory> reference = nullptr);
+    void setReference(shared_ptr<const ReferenceTrajectory> reference);
+    void reset();
+    void addSample(double t, double h);
+    double finish();
+    double getError();
+    void setCutoff(double cutoff);
+    bool exceedsCutoff();
+    double getReferenceApogee();
+
+    private:
+    shared_ptr<const ReferenceTrajectory> reference;
+    int refIndex;           //next reference sample to score
+    double errorVal;
+    double cutoff;          //error above which the flight is no longer worth finishing
+    double prevHeight;      //height of the last simulated sample
+    double heldHeight;      //height the last scored reference sample was compared against
+    bool hasSamples, finished;
+
+};
+
+
+#endif //ERROR_ACCUMULATOR_H
@@ -0,0 +1,209 @@
+#include "EvaluationCache.h"
+
+// Mixes the quantized values into one hash
+size_t CacheKeyHash::operator()(const CacheKey& key) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < 5; i++)
+    {
+        hash ^= uint64_t(key.values[i]);
+        hash *= 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+
+// Constructor for EvaluationCache objects. maxEntries bounds the total size of the cache. Gains are
+// rounded to multiples of gainQuantum and MECO height (m) and velocity (m/s) to multiples of
+// mecoQuantum before lookup.
+EvaluationCache::EvaluationCache(size_t maxEntries, double gainQuantum, double mecoQuantum)
+    : hits(0), misses(0)
+{
+    maxShardEntries = max(maxEntries/NUM_SHARDS, size_t(1));
+    this->gainQuantum = gainQuantum;
+    this->mecoQuantum = mecoQuantum;
+    fingerprint = 0;
+}
+
+
+CacheKey EvaluationCache::makeKey(double kp, double ki, double kd, double h0, double V0)
+{
+    CacheKey key;
+    key.values[0] = llround(kp/gainQuantum);
+    key.values[1] = llround(ki/gainQuantum);
+    key.values[2] = llround(kd/gainQuantum);
+    key.values[3] = llround(h0/mecoQuantum);
+    key.values[4] = llround(V0/mecoQuantum);
+    return key;
+}
+
+
+EvaluationCache::Shard& EvaluationCache::shardFor(const CacheKey& key)
+{
+    return shards[CacheKeyHash()(key) % NUM_SHARDS];
+}
+
+
+// Looks up the score of a flight. Returns true and sets score if it is cached.
+bool EvaluationCache::lookup(double kp, double ki, double kd, double h0, double V0, double& score)
+{
+    CacheKey key = makeKey(kp, ki, kd, h0, V0);
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> lock(shard.shardLock);
+
+    auto found = shard.lookupTable.find(key);
+    if (found == shard.lookupTable.end())
+    {
+        misses++;
+        return false;
+    }
+
+    // move the entry to the front so it is dropped last
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    score = found->second->second;
+    hits++;
+    return true;
+}
+
+
+// Stores the score of a flight, dropping the least recently used entry of its shard if it is full
+void EvaluationCache::insert(double kp, double ki, double kd, double h0, double V0, double score)
+{
+    insertKey(makeKey(kp, ki, kd, h0, V0), score);
+}
+
+
+void EvaluationCache::insertKey(const CacheKey& key, double score)
+{
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> lock(shard.shardLock);
+
+    auto found = shard.lookupTable.find(key);
+    if (found != shard.lookupTable.end())
+    {
+        found->second->second = score;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+        return;
+    }
+
+    shard.entries.emplace_front(key, score);
+    shard.lookupTable[key] = shard.entries.begin();
+    if (shard.entries.size() > maxShardEntries)
+    {
+        shard.lookupTable.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+}
+
+
+void EvaluationCache::clear()
+{
+    for (int i = 0; i < NUM_SHARDS; i++)
+    {
+        lock_guard<mutex> lock(shards[i].shardLock);
+        shards[i].entries.clear();
+        shards[i].lookupTable.clear();
+    }
+    hits = 0;
+    misses = 0;
+}
+
+
+// Sets the fingerprint of the settings the cached scores belong to. The entries are dropped if it
+// differs from the current one, since they were computed under other settings.
+void EvaluationCache::setFingerprint(uint64_t fingerprint)
+{
+    if (fingerprint != this->fingerprint) clear();
+    this->fingerprint = fingerprint;
+}
+
+
+size_t EvaluationCache::size()
+{
+    size_t numEntries = 0;
+    for (int i = 0; i < NUM_SHARDS; i++)
+    {
+        lock_guard<mutex> lock(shards[i].shardLock);
+        numEntries += shards[i].entries.size();
+    }
+    return numEntries;
+}
+
+
+long EvaluationCache::getHits()
+{
+    return hits;
+}
+
+
+long EvaluationCache::getMisses()
+{
+    return misses;
+}
+
+
+// Writes every entry to a text file. The first line holds the quanta and the fingerprint so a file is
+// only loaded into a cache that quantizes the same way and belongs to the same settings.
+bool EvaluationCache::save(const string& filename)
+{
+    ofstream writer(filename);
+    if (!writer.is_open())
+    {
+        cout << "Cache file failed to open in EvaluationCache::save()." << endl;
+        return false;
+    }
+
+    writer.precision(17);
+    writer << gainQuantum << " " << mecoQuantum << " " << hex << fingerprint << dec << endl;
+    for (int i = 0; i < NUM_SHARDS; i++)
+    {
+        lock_guard<mutex> lock(shards[i].shardLock);
+
+        // oldest first, so loading the file restores the usage order
+        for (auto entry = shards[i].entries.rbegin(); entry != shards[i].entries.rend(); entry++)
+        {
+            const CacheKey& key = entry->first;
+            for (int j = 0; j < 5; j++) writer << key.values[j] << " ";
+            writer << entry->second << endl;
+        }
+    }
+    return writer.good();
+}
+
+
+// Adds the entries of a file written by save(). Returns false, leaving the cache as it was, if the
+// file is missing or was written with different quanta or under a different fingerprint. The next
+// save() then replaces the file.
+bool EvaluationCache::load(const string& filename)
+{
+    ifstream reader(filename);
+    if (!reader.is_open()) return false;
+
+    double fileGainQuantum, fileMecoQuantum;
+    uint64_t fileFingerprint;
+    if (!(reader >> fileGainQuantum >> fileMecoQuantum >> hex >> fileFingerprint >> dec) 
+        || fileGainQuantum != gainQuantum || fileMecoQuantum != mecoQuantum || fileFingerprint != fingerprint)
+    {
+        cout << "Cache file " << filename << " was saved with other references or settings, discarding it in "
+            << "EvaluationCache::load()." << endl;
+        return false;
+    }
+
+    CacheKey key;
+    double score;
+    while (reader >> key.values[0] >> key.values[1] >> key.values[2] >> key.values[3] >> key.values[4] >> score)
+    {
+        insertKey(key, score);
+    }
+    return true;
+}
+
+
+void EvaluationCache::printStats()
+{
+    long numHits = hits, numMisses = misses;
+    double hitRate = (numHits + numMisses > 0) ? 100.0*numHits/(numHits + numMisses) : 0;
+    cout << "Evaluation cache: " << size() << " entries, " << numHits << " hits, " << numMisses 
+        << " misses (" << hitRate << "% hit rate)." << endl;
+}
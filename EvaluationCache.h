@@ -0,0 +1,88 @@
+#ifndef EVALUATION_CACHE_H
+#define EVALUATION_CACHE_H
+
+/*
+File: EvaluationCache.h
+Author: Gerritt Graham
+Description: Bounded cache of trajectory error scores, keyed on the PID gains and MECO conditions of
+a flight. Values are quantized before lookup, so gains that only differ below the quantum (for example
+candidates clamped onto the same bound) share one simulation. The cache is split into shards with
+their own locks so worker threads can use it at once, and each shard drops its least recently used
+entries when full. The cache can be saved to and loaded from a text file so later tuning sessions
+reuse earlier evaluations. Scores are only valid for the reference trajectories, controller and
+simulator settings they were computed with, so the cache carries a fingerprint of those (see
+GainOptimizer::setCache()) and a file saved under another fingerprint is not loaded.
+*/
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+using namespace std;
+
+// Quantized gains and MECO conditions of one flight
+struct CacheKey
+{
+    int64_t values[5];      //kp, ki, kd, height, velocity in units of their quanta
+
+    bool operator==(const CacheKey& other) const
+    {
+        for (int i = 0; i < 5; i++) if (values[i] != other.values[i]) return false;
+        return true;
+    }
+};
+
+struct CacheKeyHash
+{
+    size_t operator()(const CacheKey& key) const;
+};
+
+class EvaluationCache
+{
+    public:
+    EvaluationCache(size_t maxEntries = 100000, double gainQuantum = 1e-6, double mecoQuantum = 1e-6);
+    EvaluationCache(const EvaluationCache&) = delete;
+    EvaluationCache& operator=(const EvaluationCache&) = delete;
+    bool lookup(double kp, double ki, double kd, double h0, double V0, double& score);
+    void insert(double kp, double ki, double kd, double h0, double V0, double score);
+    void clear();
+    void setFingerprint(uint64_t fingerprint);
+    size_t size();
+    long getHits();
+    long getMisses();
+    bool save(const string& filename);
+    bool load(const string& filename);
+    void printStats();
+
+    private:
+    static const int NUM_SHARDS = 16;
+
+    struct Shard
+    {
+        mutex shardLock;
+        list<pair<CacheKey, double>> entries;      //most recently used first
+        unordered_map<CacheKey, list<pair<CacheKey, double>>::iterator, CacheKeyHash> lookupTable;
+    };
+
+    Shard shards[NUM_SHARDS];
+    size_t maxShardEntries;
+    double gainQuantum, mecoQuantum;
+    uint64_t fingerprint;       //hash of everything the scores depend on besides the key
+    atomic<long> hits, misses;
+
+    CacheKey makeKey(double kp, double ki, double kd, double h0, double V0);
+    Shard& shardFor(const CacheKey& key);
+    void insertKey(const CacheKey& key, double score);
+
+};
+
+
+#endif //EVALUATION_CACHE_H
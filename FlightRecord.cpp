@@ -0,0 +1,178 @@
+#include "FlightRecord.h"
+
+FlightRecord::FlightRecord(RecordPolicy policy, double interval)
+{
+    setPolicy(policy, interval);
+    lastRecordTime = 0;
+}
+
+
+// Selects how many samples are kept. With RECORD_DECIMATED a sample is only kept once more than
+// interval seconds have passed since the last kept sample, which is the same spacing write() applies,
+// so records written at the default 0.1 s interval are unchanged.
+void FlightRecord::setPolicy(RecordPolicy policy, double interval)
+{
+    this->policy = policy;
+    this->interval = interval;
+}
+
+
+RecordPolicy FlightRecord::getPolicy()
+{
+    return policy;
+}
+
+
+// Drops every sample. The vectors keep their capacity.
+void FlightRecord::clear()
+{
+    timeVals.clear();
+    heightVals.clear();
+    velocityVals.clear();
+    accelVals.clear();
+    alphaVals.clear();
+}
+
+
+// Reserves room for a whole flight starting at velocity V0 (m/s) and integrated every heightStep (m),
+// so recording never has to grow the vectors mid-flight. The drag-free coast height V0^2/(2g) and
+// coast time V0/g bound the number of height steps and decimated samples. Capacity is kept across
+// clear(), so a reused record only allocates for its first flight.
+void FlightRecord::reserveFlight(double V0, double heightStep)
+{
+    size_t numSamples = 0;
+    if (policy == RECORD_FULL) numSamples = size_t(0.5*V0*V0/g / heightStep) + 2;
+    else if (policy == RECORD_DECIMATED) numSamples = size_t(V0/g / interval) + 2;
+
+    timeVals.reserve(numSamples);
+    heightVals.reserve(numSamples);
+    velocityVals.reserve(numSamples);
+    accelVals.reserve(numSamples);
+    alphaVals.reserve(numSamples);
+}
+
+
+// Stores one sample of the flight according to the record policy. The initial state is always kept
+// unless recording is off.
+void FlightRecord::addSample(double t, double h, double V, double a, double alpha, bool initialState)
+{
+    if (policy == RECORD_NONE) return;
+    if (policy == RECORD_DECIMATED)
+    {
+        if (!initialState && !(t > lastRecordTime+interval)) return;
+        lastRecordTime = t;
+    }
+
+    timeVals.push_back(t);
+    heightVals.push_back(h);
+    velocityVals.push_back(V);
+    accelVals.push_back(a);
+    alphaVals.push_back(alpha);
+}
+
+
+size_t FlightRecord::size()
+{
+    return timeVals.size();
+}
+
+
+// Writes the record to the file filename. Recorded values are spaced out every 0.1 seconds to reduce
+// data volume. Returns false if nothing was written.
+bool FlightRecord::write(const string& filename)
+{
+    if (!isWritable()) return false;
+
+    //open output file stream 
+    ofstream writer(filename);
+    if(!writer.is_open())
+    {
+        cout << "Output file did not open in FlightRecord::write()." << endl;
+        return false;
+    }
+
+    string buffer;
+    format(buffer, time(0));
+    writer.write(buffer.data(), buffer.size());
+    return true;
+}
+
+
+// Returns true if the record holds data and every channel has the same number of samples, reporting
+// the problem otherwise
+bool FlightRecord::isWritable()
+{
+    if (timeVals.empty())
+    {
+        cout << "No flight data recorded in FlightRecord::write()." << endl;
+        return false;
+    }
+
+    //check that all information vectors are the same size
+    if(!(timeVals.size() == heightVals.size() 
+        && timeVals.size() == velocityVals.size()
+        && timeVals.size() == alphaVals.size()
+        && timeVals.size() == accelVals.size()))
+    {
+        cout << "Vectors not of same size in FlightRecord::write()." << endl;
+        cout << "Time: " << timeVals.size() << endl;
+        cout << "Height: " << heightVals.size() << endl;
+        cout << "Vel: " << velocityVals.size() << endl;
+        cout << "Accel: " << accelVals.size() << endl;
+        cout << "Angle: " << alphaVals.size() << endl;
+        return false;
+    }
+    return true;
+}
+
+
+// Appends value to buffer the way ostream << prints a double by default (%g with 6 significant digits)
+static void appendValue(string& buffer, double value)
+{
+    char digits[32];
+    to_chars_result result = to_chars(digits, digits + sizeof(digits), value, chars_format::general, 6);
+    buffer.append(digits, result.ptr);
+}
+
+
+// Appends the contents of the record file to buffer: a header stamped with createdTime followed by the
+// samples spaced out every 0.1 seconds
+void FlightRecord::format(string& buffer, time_t createdTime)
+{
+    //space out generated data to reduce data volume
+    FlightRecord spaced = decimate(0.1);
+
+    buffer += "Simulation created and run on: \n";
+    buffer += asctime(localtime(&createdTime));
+    buffer += "\n\n";
+    buffer += "Time (s), Height (m), Velocity (m/s), Acceleration (m/s^2), Deployment Angle (degrees)\n";
+    for(int i = 0; i < spaced.size(); i++)
+    {
+        appendValue(buffer, spaced.timeVals.at(i));
+        buffer += ' ';
+        appendValue(buffer, spaced.heightVals.at(i));
+        buffer += ' ';
+        appendValue(buffer, spaced.velocityVals.at(i));
+        buffer += ' ';
+        appendValue(buffer, spaced.accelVals.at(i));
+        buffer += ' ';
+        appendValue(buffer, spaced.alphaVals.at(i) * (180/M_PI));
+        buffer += '\n';
+    }
+}
+
+
+// Returns a copy of the record that keeps the first sample and then one sample each time more than
+// timeInterval seconds have passed since the last kept one
+FlightRecord FlightRecord::decimate(double timeInterval)
+{
+    FlightRecord spaced(RECORD_DECIMATED, timeInterval);
+    if (timeVals.empty()) return spaced;
+
+    spaced.addSample(timeVals.at(0), heightVals.at(0), velocityVals.at(0), accelVals.at(0), alphaVals.at(0), true);
+    for(int i = 0; i < timeVals.size(); i++)
+    {
+        spaced.addSample(timeVals.at(i), heightVals.at(i), velocityVals.at(i), accelVals.at(i), alphaVals.at(i));
+    }
+    return spaced;
+}
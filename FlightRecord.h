@@ -0,0 +1,57 @@
+#ifndef FLIGHT_RECORD_H
+#define FLIGHT_RECORD_H
+
+/*
+File: FlightRecord.h
+Author: Gerritt Graham
+Description: Time history of one simulated flight (time, height, velocity, acceleration and paddle
+angle) stored as one vector per channel. The record policy decides how many samples are kept, and
+write() produces the record files used for reference trajectories and simulation results. format()
+builds the file contents with std::to_chars, which gives the same text as the default ostream format,
+so the same files can also be written in the background by RecordWriter.
+*/
+
+#include "consts.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <ctime>
+#include <charconv>
+
+using namespace std;
+
+// How much of a flight is kept in memory
+enum RecordPolicy
+{
+    RECORD_NONE,        //keep nothing, only the apogee and an attached ErrorAccumulator are available
+    RECORD_DECIMATED,   //keep the first sample, then one sample every record interval
+    RECORD_FULL         //keep every height step
+};
+
+class FlightRecord
+{
+    public:
+    FlightRecord(RecordPolicy policy = RECORD_FULL, double interval = 0.1);
+    void setPolicy(RecordPolicy policy, double interval = 0.1);
+    RecordPolicy getPolicy();
+    void clear();
+    void reserveFlight(double V0, double heightStep);
+    void addSample(double t, double h, double V, double a, double alpha, bool initialState = false);
+    FlightRecord decimate(double timeInterval);
+    bool write(const string& filename);
+    bool isWritable();
+    void format(string& buffer, time_t createdTime);
+    size_t size();
+
+    vector<double> timeVals, heightVals, velocityVals, accelVals, alphaVals;
+
+    private:
+    RecordPolicy policy;
+    double interval, lastRecordTime;    //s
+
+};
+
+
+#endif //FLIGHT_RECORD_H
@@ -1,10 +1,14 @@
 #include "GainOptimizer.h"
+#include "CMAESEngine.h"
+#include "NelderMeadEngine.h"
+#include "SurrogateEngine.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 
-GainOptimizer::GainOptimizer()
+GainOptimizer::GainOptimizer(int numThreads)
+    : robustObjective(RobustObjective::diagonalPerturbations(5, 20, 10))
 {
     //initialize temperature and iterations
     initialTemp = 200;
@@ -13,98 +17,491 @@ GainOptimizer::GainOptimizer()
     //set bounds
     bounds = {0, 30, 0, 5, 0, 3};
 
-    //seed random number generator with current time
-    srand(time(0));
+    //a single chain by default, like the original optimizer
+    setNumThreads(numThreads);
+    numChains = 1;
+    exchangeInterval = 0;
+    ladderRatio = 1.5;
+    objectiveMode = OBJECTIVE_NOMINAL;
+    cache = nullptr;
+    controlPeriod = 0;
+    earlyAbort = false;
+    engineType = ENGINE_ANNEALING;
+    maxEvaluations = 0;
+    numEvaluations = evaluationsToConverge = 0;
+
+    //seed random number generators with current time
+    seed = time(0);
+    runNum = 0;
 }
 
 
-Solution GainOptimizer::evaluate()
+// Sets the number of worker threads the chains are spread over. A value of 0 or less uses every core.
+void GainOptimizer::setNumThreads(int numThreads)
+{
+    this->numThreads = resolveThreadCount(numThreads);
+}
+
+
+// Sets the seed of every random number stream. Runs started after this call are reproducible.
+void GainOptimizer::setSeed(unsigned int seed)
+{
+    this->seed = seed;
+    runNum = 0;
+}
+
+
+// Sets the number of chains run by evaluate()
+void GainOptimizer::setNumChains(int numChains)
+{
+    this->numChains = max(numChains, 1);
+}
+
+
+// Makes the chains in evaluate() swap current solutions every exchangeInterval iterations. Chain k
+// accepts moves at ladderRatio^k times the scheduled temperature, so hot chains explore and hand good
+// solutions down to cold chains. An interval of 0 runs independent chains.
+void GainOptimizer::setExchange(int exchangeInterval, double ladderRatio)
 {
-    //generate and evaluate random starting solution
-    bestSoln.setGains(1,1,1);
-    bestSoln.setScore(objectiveFunction(bestSoln));
+    this->exchangeInterval = max(exchangeInterval, 0);
+    this->ladderRatio = ladderRatio;
+}
 
-    //set starting point as current solution
-    currSoln.equals(bestSoln);
 
-    //initialize temperature variable
-    double currTemp = initialTemp;
+// Selects what the annealer minimizes
+void GainOptimizer::setObjective(ObjectiveMode mode)
+{
+    objectiveMode = mode;
+}
+
 
-    for (int i = 0; i < numIterations; i++)
+// Sets the MECO perturbations used by the robust objective modes and by findPerturbationSolution().
+// The default is 5 points from (-40 m, -20 m/s) to (+40 m, +20 m/s).
+void GainOptimizer::setPerturbations(const vector<MecoPerturbation>& perturbations, double percentileLevel)
+{
+    robustObjective.setPerturbations(perturbations, percentileLevel);
+}
+
+
+// Scores a set of gains against every perturbation, flying them concurrently on the worker threads
+RobustScore GainOptimizer::scoreRobust(Solution soln)
+{
+    return robustObjective.evaluate(soln, numThreads);
+}
+
+
+// Shares a cache of flight scores between every simulation the optimizer runs. Pass nullptr to
+// stop using it. The cache is given the fingerprint of the optimizer's settings, dropping entries
+// computed under others, so set the cache before loading a saved one into it.
+void GainOptimizer::setCache(EvaluationCache* cache)
+{
+    this->cache = cache;
+    context.setCache(cache);
+    for (int i = 0; i < workerContexts.size(); i++) workerContexts.at(i)->setCache(cache);
+    robustObjective.setCache(cache);
+    updateCacheFingerprint();
+}
+
+
+// Runs the controller once per controlPeriod (s) in every flight the optimizer simulates, so gains are
+// tuned for a flight computer with a fixed rate control loop. See Simulator::setControlPeriod(). The
+// default of 0 runs the controller after every step. Scores cached under another period are dropped.
+void GainOptimizer::setControlPeriod(double controlPeriod)
+{
+    this->controlPeriod = controlPeriod;
+    context.setControlPeriod(controlPeriod);
+    for (int i = 0; i < workerContexts.size(); i++) workerContexts.at(i)->setControlPeriod(controlPeriod);
+    robustObjective.setControlPeriod(controlPeriod);
+    updateCacheFingerprint();
+}
+
+
+// Fingerprints the attached cache with the simulation settings. Cached scores are per flight and do
+// not depend on the objective mode, so switching modes keeps the cache.
+void GainOptimizer::updateCacheFingerprint()
+{
+    if (!cache) return;
+    cache->setFingerprint(context.fingerprint());
+}
+
+
+// Stops each candidate's flight as soon as its error shows it would be rejected. The Metropolis test
+// accepts a candidate if its score is below currSoln.score - T*ln(u), so u is drawn before the flight
+// and the cutoff is the larger of that threshold and the chain's best score, so a stopped candidate
+// could neither be accepted nor become the best. The result is the same as without early abort. Only
+// used with OBJECTIVE_NOMINAL.
+void GainOptimizer::setEarlyAbort(bool earlyAbort)
+{
+    this->earlyAbort = earlyAbort;
+}
+
+
+// Selects the search algorithm used by optimize()
+void GainOptimizer::setEngine(OptimizerEngineType engineType)
+{
+    this->engineType = engineType;
+}
+
+
+// Limits the number of candidates the CMA-ES and Nelder-Mead engines may score. The default of 0
+// gives them the annealer's budget of one evaluation per iteration and chain, plus the start point.
+void GainOptimizer::setMaxEvaluations(int maxEvaluations)
+{
+    this->maxEvaluations = max(maxEvaluations, 0);
+}
+
+
+// Name of an engine, taken from the engine itself. The annealer is not an OptimizerEngine.
+string GainOptimizer::engineName(OptimizerEngineType engineType)
+{
+    unique_ptr<OptimizerEngine> engine = createEngine(engineType);
+    return engine ? engine->getName() : "Annealing";
+}
+
+
+// Creates the search engine of the given type, or nullptr for the annealer, which runs in the
+// optimizer itself. numThreads sets the batch size of the surrogate engine.
+unique_ptr<OptimizerEngine> GainOptimizer::createEngine(OptimizerEngineType engineType, int numThreads)
+{
+    if (engineType == ENGINE_CMAES) return make_unique<CMAESEngine>();
+    else if (engineType == ENGINE_NELDER_MEAD) return make_unique<NelderMeadEngine>();
+    else if (engineType == ENGINE_SURROGATE) return make_unique<SurrogateEngine>(max(numThreads, 4));
+    else return nullptr;
+}
+
+
+// Runs the selected engine from the gains (1, 1, 1) and reports how many evaluations it used and how
+// many it needed to get within 1 percent of its final best score. Cache hits count as evaluations.
+Solution GainOptimizer::optimize()
+{
+    progress.clear();
+    Solution bestSoln;
+
+    if (engineType == ENGINE_ANNEALING) bestSoln = evaluate();
+    else
     {
-        //move currSoln to the optimal close to the end of the annealing
-        if (i == int(0.6*numIterations)) currSoln.equals(bestSoln);
+        unique_ptr<OptimizerEngine> engine = createEngine(engineType, numThreads);
 
-        //take random step
-        Solution candidateSoln = takeStep(currSoln, currTemp);
+        seed_seq engineSeed = {seed, runNum++, 0u};
+        mt19937 rng(engineSeed);
+        int budget = (maxEvaluations > 0) ? maxEvaluations : 1 + numIterations*numChains;
 
-        //ensure solution is within bounds
-        enforceBounds(candidateSoln);
+        int evaluations = 0;
+        double bestScore = numeric_limits<double>::infinity();
+        BatchObjective countedScoreBatch = [&](vector<Solution>& batch)
+        {
+            scoreBatch(batch);
+            for (int i = 0; i < batch.size(); i++) bestScore = min(bestScore, batch.at(i).score);
+            evaluations += batch.size();
+            recordProgress(evaluations, bestScore);
+        };
+
+        bestSoln = engine->optimize(countedScoreBatch, bounds, Solution(1,1,1), budget, rng);
+        cout << "kp: " << bestSoln.kp << endl;
+        cout << "ki: " << bestSoln.ki << endl;
+        cout << "kd: " << bestSoln.kd << endl;
+    }
 
-        //evaluate new candidate solution
-        candidateSoln.setScore(objectiveFunction(candidateSoln));
-        
-        //update best if candidate solution is better
-        if(candidateSoln.score < bestSoln.score) 
+    numEvaluations = progress.empty() ? 0 : progress.back().first;
+    evaluationsToConverge = numEvaluations;
+    for (int i = 0; i < progress.size(); i++)
+    {
+        if (progress.at(i).second <= bestSoln.score + 0.01*abs(bestSoln.score))
         {
-            bestSoln.equals(candidateSoln);
-            cout << "New best found. kp = " << bestSoln.kp << ", ki = " 
-                << bestSoln.ki << ", kd = " << bestSoln.kd << endl;
+            evaluationsToConverge = progress.at(i).first;
+            break;
         }
+    }
+    cout << engineName(engineType) << ": best score " << bestSoln.score << " after " << numEvaluations 
+        << " simulations, within 1% of it after " << evaluationsToConverge << "." << endl;
+
+    return bestSoln;
+}
+
+
+// Number of candidates scored by the last call to optimize()
+int GainOptimizer::getNumEvaluations()
+{
+    return numEvaluations;
+}
+
+
+// Number of candidates the last call to optimize() scored before its best was within 1 percent of
+// the final best
+int GainOptimizer::getEvaluationsToConverge()
+{
+    return evaluationsToConverge;
+}
+
+
+// Scores a batch of candidates from an engine, spread over the worker threads
+void GainOptimizer::scoreBatch(vector<Solution>& batch)
+{
+    int numWorkers = min(numThreads, int(batch.size()));
+    while (workerContexts.size() < numWorkers)
+    {
+        workerContexts.push_back(make_unique<SimulationContext>());
+        workerContexts.back()->setCache(cache);
+        workerContexts.back()->setControlPeriod(controlPeriod);
+    }
+
+    parallelFor(batch.size(), numWorkers, [&](int i, int workerNum)
+    {
+        enforceBounds(batch.at(i));
+        batch.at(i).setScore(objectiveFunction(batch.at(i), *workerContexts.at(workerNum), numWorkers > 1));
+    });
+}
+
+
+void GainOptimizer::recordProgress(int evaluations, double bestScore)
+{
+    progress.push_back(make_pair(evaluations, bestScore));
+}
+
+
+// Anneals numChains chains and returns the best solution found by any of them
+Solution GainOptimizer::evaluate()
+{
+    vector<Solution> chainBests = runChains(numChains, exchangeInterval);
+
+    Solution bestSoln = chainBests.at(0);
+    for (int k = 1; k < chainBests.size(); k++)
+    {
+        if (chainBests.at(k).score < bestSoln.score) bestSoln.equals(chainBests.at(k));
+    }
+    cout << "kp: " << bestSoln.kp << endl;
+    cout << "ki: " << bestSoln.ki << endl;
+    cout << "kd: " << bestSoln.kd << endl;
+
+    return bestSoln;
+}
+
+
+// Runs numChains annealing chains for numIterations each and returns the best solution of each chain.
+// The chains advance together one epoch at a time, running in parallel within an epoch. Between
+// epochs they may swap solutions, and progress is reported in chain order, so the results and the
+// output only depend on the seed.
+vector<Solution> GainOptimizer::runChains(int numChains, int exchangeInterval)
+{
+    int numWorkers = min(numThreads, numChains);
+    while (workerContexts.size() < numWorkers)
+    {
+        workerContexts.push_back(make_unique<SimulationContext>());
+        workerContexts.back()->setCache(cache);
+        workerContexts.back()->setControlPeriod(controlPeriod);
+    }
+
+    unsigned int currRun = runNum++;
+    vector<AnnealChain> chains(numChains);
+    for (int k = 0; k < numChains; k++)
+    {
+        seed_seq chainSeed = {seed, currRun, (unsigned int)k + 1};
+        chains.at(k).rng.seed(chainSeed);
+        chains.at(k).currTemp = initialTemp;
+        chains.at(k).tempScale = (exchangeInterval > 0) ? pow(ladderRatio, k) : 1;
+    }
+    seed_seq swapSeed = {seed, currRun, 0u};
+    mt19937 exchangeRng(swapSeed);
 
-        //decrease temperature with piecewise linear annealing schedule
-        if (i < 0.6*numIterations) 
+    //generate and evaluate starting solution, the same for every chain
+    Solution startSoln(1,1,1);
+    startSoln.setScore(objectiveFunction(startSoln, context, false));
+    for (int k = 0; k < numChains; k++)
+    {
+        chains.at(k).bestSoln.equals(startSoln);
+        chains.at(k).currSoln.equals(startSoln);
+    }
+    Solution bestSoln = startSoln;
+
+    int epochLength = (exchangeInterval > 0) ? exchangeInterval : EPOCH_LENGTH;
+    for (int epochStart = 0, epochNum = 0; epochStart < numIterations; epochStart += epochLength, epochNum++)
+    {
+        int epochEnd = min(epochStart + epochLength, numIterations);
+        for (int i = epochStart; i < epochEnd; i++)
         {
-            currTemp = initialTemp - (0.1*initialTemp/(0.6*numIterations)) * i;
+            if(i % 50 == 0) cout << "Iteration: " << i << endl;
         }
-        else if (i >= 0.6*numIterations && i <= numIterations) 
+
+        parallelFor(numChains, numWorkers, [&](int chainNum, int workerNum)
+        {
+            for (int i = epochStart; i < epochEnd; i++)
+            {
+                annealStep(chains.at(chainNum), i, *workerContexts.at(workerNum), numWorkers > 1);
+            }
+        });
+
+        //update best if any chain found a better solution
+        for (int k = 0; k < numChains; k++)
         {
-            currTemp = initialTemp - (0.9*initialTemp/(0.4*numIterations)) * (i - 0.6*numIterations);
+            if (chains.at(k).bestSoln.score < bestSoln.score)
+            {
+                bestSoln.equals(chains.at(k).bestSoln);
+                cout << "New best found. kp = " << bestSoln.kp << ", ki = " 
+                    << bestSoln.ki << ", kd = " << bestSoln.kd << endl;
+            }
         }
-        else cout << "Error in GainOptimizer::evaluate(), i index out of bounds." << endl;
 
-        //calculate metropolis acceptance criteria
-        double diff = candidateSoln.score - currSoln.score;
-        double metropolisCriteria = exp(-diff/currTemp);
+        recordProgress(1 + epochEnd*numChains, bestSoln.score);
 
-        //compare metropolis criteria to random value between 0 and 1 for acceptance
-        //if diff is negative, solution is automatically accepted (represents better soln)
-        if (diff < 0 || ((rand() % 100) / 100.0) < metropolisCriteria)
+        //moving to the best solution at 60 percent is done by each chain, don't undo it with a swap
+        if (exchangeInterval > 0 && numChains > 1 && epochEnd < int(0.6*numIterations))
         {
-            currSoln.equals(candidateSoln);
+            exchangeSolutions(chains, epochNum, exchangeRng);
         }
-
-        if(i % 50 == 0) cout << "Iteration: " << i << endl;
     }
-    cout << "kp: " << bestSoln.kp << endl;
-    cout << "ki: " << bestSoln.ki << endl;
-    cout << "kd: " << bestSoln.kd << endl;
 
-    return bestSoln;
+    if (earlyAbort) printAbortStats();
+
+    vector<Solution> chainBests;
+    for (int k = 0; k < numChains; k++) chainBests.push_back(chains.at(k).bestSoln);
+    return chainBests;
 }
 
 
-double GainOptimizer::objectiveFunction(Solution soln)
+// Reports how much simulation early abort has saved so far
+void GainOptimizer::printAbortStats()
 {
-    double result = 0;
-    
-    Controller controller(soln.kp, soln.ki, soln.kd, mecoHeight+height_perturbation, mecoVelocity+vel_perturbation);
-    Simulator currSim(mecoHeight+height_perturbation, mecoVelocity+vel_perturbation);
+    long numFlights = context.getNumFlights();
+    long numAborted = context.getNumAborted();
+    long skippedSteps = context.getSkippedSteps();
+    for (int i = 0; i < workerContexts.size(); i++)
+    {
+        numFlights += workerContexts.at(i)->getNumFlights();
+        numAborted += workerContexts.at(i)->getNumAborted();
+        skippedSteps += workerContexts.at(i)->getSkippedSteps();
+    }
+    cout << "Early abort: " << numAborted << " of " << numFlights << " flights stopped, about " 
+        << skippedSteps << " steps skipped." << endl;
+}
+
+
+// Runs one iteration of the annealing algorithm on a single chain
+void GainOptimizer::annealStep(AnnealChain& chain, int i, SimulationContext& context, bool chainsParallel)
+{
+    //move currSoln to the optimal close to the end of the annealing
+    if (i == int(0.6*numIterations)) chain.currSoln.equals(chain.bestSoln);
+
+    //take random step
+    Solution candidateSoln = takeStep(chain.currSoln, chain.currTemp, chain.rng);
+
+    //ensure solution is within bounds
+    enforceBounds(candidateSoln);
 
-    currSim.simulate(controller);
-    result = currSim.calcError(controller.getTrajectoryNum());
+    //decrease temperature with piecewise linear annealing schedule
+    chain.currTemp = scheduleTemp(i);
+
+    //draw the acceptance value now so it can bound the candidate's flight
+    uniform_int_distribution<int> percent(0, 99);
+    double acceptValue = percent(chain.rng) / 100.0;
+    double acceptTemp = chain.currTemp*chain.tempScale;
+
+    //evaluate new candidate solution, stopping once it can neither be accepted nor beat the chain's
+    //best. The small margin keeps rounding in the threshold from stopping a flight the tests below
+    //would keep.
+    double cutoff = numeric_limits<double>::infinity();
+    if (earlyAbort && objectiveMode == OBJECTIVE_NOMINAL && acceptValue > 0)
+    {
+        double threshold = max(chain.currSoln.score - acceptTemp*log(acceptValue), chain.bestSoln.score);
+        cutoff = threshold + 1e-9*abs(threshold);
+    }
+    candidateSoln.setScore(objectiveFunction(candidateSoln, context, chainsParallel, cutoff));
+    if (earlyAbort && context.lastFlightAborted())
+    {
+        INSTRUMENT_COUNT(COUNT_ANNEAL_ABORTED, 1);
+        return;
+    }
     
-    return result;
-            
- }
+    //update best if candidate solution is better
+    if(candidateSoln.score < chain.bestSoln.score) chain.bestSoln.equals(candidateSoln);
+
+    //calculate metropolis acceptance criteria
+    double diff = candidateSoln.score - chain.currSoln.score;
+    double metropolisCriteria = exp(-diff/acceptTemp);
+
+    //compare metropolis criteria to random value between 0 and 1 for acceptance
+    //if diff is negative, solution is automatically accepted (represents better soln)
+    if (diff < 0 || acceptValue < metropolisCriteria)
+    {
+        chain.currSoln.equals(candidateSoln);
+        INSTRUMENT_COUNT(COUNT_ANNEAL_ACCEPTED, 1);
+    }
+    else INSTRUMENT_COUNT(COUNT_ANNEAL_REJECTED, 1);
+}
+
+
+// Offers to swap the current solutions of neighbouring chains on the temperature ladder. Even epochs
+// pair chains (0,1), (2,3)... and odd epochs pair (1,2), (3,4)... A swap is accepted with the
+// parallel tempering probability min(1, exp((E_k - E_k+1)(1/T_k - 1/T_k+1))).
+void GainOptimizer::exchangeSolutions(vector<AnnealChain>& chains, int epochNum, mt19937& exchangeRng)
+{
+    uniform_real_distribution<double> unit(0, 1);
+    for (int k = epochNum % 2; k + 1 < chains.size(); k += 2)
+    {
+        AnnealChain& cold = chains.at(k);
+        AnnealChain& hot = chains.at(k+1);
+        double coldTemp = cold.currTemp*cold.tempScale;
+        double hotTemp = hot.currTemp*hot.tempScale;
+        double exponent = (cold.currSoln.score - hot.currSoln.score) * (1/coldTemp - 1/hotTemp);
+
+        if (exponent >= 0 || unit(exchangeRng) < exp(exponent))
+        {
+            Solution temp = cold.currSoln;
+            cold.currSoln.equals(hot.currSoln);
+            hot.currSoln.equals(temp);
+        }
+    }
+}
+
 
-Solution GainOptimizer::takeStep(Solution currSoln, double currTemp)
+// Piecewise linear annealing schedule. The temperature drops by 10 percent over the first 60 percent
+// of the iterations and by the remaining 90 percent over the rest.
+double GainOptimizer::scheduleTemp(int i)
+{
+    if (i < 0.6*numIterations) 
+    {
+        return initialTemp - (0.1*initialTemp/(0.6*numIterations)) * i;
+    }
+    else if (i >= 0.6*numIterations && i <= numIterations) 
+    {
+        return initialTemp - (0.9*initialTemp/(0.4*numIterations)) * (i - 0.6*numIterations);
+    }
+    cout << "Error in GainOptimizer::scheduleTemp(), i index out of bounds." << endl;
+    return initialTemp;
+}
+
+
+// Scores a set of gains by flying the rocket from the nominal MECO conditions, or from every
+// perturbation in the robust modes, and comparing the flights to the reference trajectory. The
+// simulation objects are reused between calls. If the chains are already spread over the worker
+// threads the perturbations are flown on the caller's context, otherwise they are flown concurrently.
+// cutoff is passed on to nominal flights, see SimulationContext::scoreGains().
+double GainOptimizer::objectiveFunction(Solution soln, SimulationContext& context, bool chainsParallel,
+    double cutoff)
+{
+    INSTRUMENT_TIMER(TIME_OBJECTIVE);
+    if (objectiveMode == OBJECTIVE_NOMINAL)
+    {
+        return context.scoreGains(soln.kp, soln.ki, soln.kd, mecoHeight, mecoVelocity, cutoff);
+    }
+
+    RobustScore robustScore;
+    if (chainsParallel) robustScore = robustObjective.evaluate(soln, context);
+    else robustScore = robustObjective.evaluate(soln, numThreads);
+
+    if (objectiveMode == OBJECTIVE_MEAN) return robustScore.mean;
+    else if (objectiveMode == OBJECTIVE_WORST) return robustScore.worst;
+    else return robustScore.percentile;
+}
+
+
+Solution GainOptimizer::takeStep(Solution currSoln, double currTemp, mt19937& rng)
 {
     Solution candidateSoln;
+    uniform_int_distribution<int> kpDraw(0, 4999), kiDraw(0, 999), kdDraw(0, 499);
 
-    double kpStep = (rand() % 5000*(currTemp/initialTemp) / 500.0) - 5;
-    double kiStep = (rand() % 1000*(currTemp/initialTemp) / 500.0) - 1;
-    double kdStep = (rand() % 500*(currTemp/initialTemp) / 500.0) - 0.5;
+    double kpStep = (kpDraw(rng)*(currTemp/initialTemp) / 500.0) - 5;
+    double kiStep = (kiDraw(rng)*(currTemp/initialTemp) / 500.0) - 1;
+    double kdStep = (kdDraw(rng)*(currTemp/initialTemp) / 500.0) - 0.5;
 
     candidateSoln.kp = currSoln.kp + kpStep;
     candidateSoln.ki = currSoln.ki + kiStep;
@@ -126,18 +523,16 @@ void GainOptimizer::enforceBounds(Solution& candidateSoln)
     else if (candidateSoln.kd > bounds.at(5)) candidateSoln.kd = bounds.at(5);
 }
 
+// Tunes five sets of gains with independent annealing runs, then checks how robust each set is by
+// scoring it against the MECO perturbations
 void GainOptimizer::findPerturbationSolution(){
 
     vector<Solution> Solution_Options;
-    vector<double> Final_Score;
 
-    double numSolns = 5;
+    int numSolns = 5;
     
-    for (int i = 0; i < numSolns; i++){
-        evaluate();
-        Solution_Options.push_back(bestSoln);
-        cout << "Added something to the vector" << endl;
-    }
+    //independent chains, run in parallel, stand in for separate restarts of the annealing
+    Solution_Options = runChains(numSolns, 0);
     
     cout << " I will now print the 5 sets of gains" << endl;
     
@@ -146,32 +541,11 @@ void GainOptimizer::findPerturbationSolution(){
           << Solution_Options.at(i).ki << " " <<"kd"<< " " << " " << Solution_Options.at(i).kd << endl;
     }
     
-   for (int i = 0; i < numSolns; i++){
-        height_perturbation = -40;
-        vel_perturbation = -20;
-        Solution_Options.at(i);
-
-        for (int j = 0; j < numSolns; j++){
-            double result = objectiveFunction(Solution_Options.at(i)); 
-            height_perturbation += 20;
-            vel_perturbation += 10;
-            Final_Score.push_back(result);
-        }
-
-    }
-    int k = 0;
-    //Averages Scores and Associated Gains
-    for (int j = 0; j <= 4; j++){
-    double A = Final_Score[0 + k];
-    double B = Final_Score[1 + k];
-    double C = Final_Score[2 + k];
-    double D = Final_Score[3 + k];
-    double E = Final_Score[4 + k];
-    double sum = A + B + C + D + E;
-    double avg = sum/5;
-    k += 5;
-    cout << "kp" << " " << " " << Solution_Options.at(j).kp << " " << "ki" << " " << " " 
-      << Solution_Options.at(j).ki << " " <<"kd"<< " " << " " << Solution_Options.at(j).kd <<  " " 
-      << "The Score Average For These Gains Are" << " " << avg << endl;
+    for (int j = 0; j < numSolns; j++){
+        RobustScore robustScore = scoreRobust(Solution_Options.at(j));
+        cout << "kp" << " " << " " << Solution_Options.at(j).kp << " " << "ki" << " " << " " 
+          << Solution_Options.at(j).ki << " " <<"kd"<< " " << " " << Solution_Options.at(j).kd <<  " " 
+          << "The Score Average For These Gains Are" << " " << robustScore.mean 
+          << ", worst " << robustScore.worst << endl;
     }
 }
\ No newline at end of file
@@ -8,35 +8,119 @@ Description: Class implementing a simluated annealing optimizer to automatically
 controller. The optimizer uses a linear annealing schedule and the Metropolis acceptance criteria. The 
 objective function runs a simulation using the Simulator class, and compares the final trajectory to the
 reference trajectory with a weighted average to calculate error.  
+Several annealing chains can be run at once on worker threads. Each chain draws from its own random
+number stream seeded from the optimizer seed, and chains only interact at the end of fixed-length
+epochs, so a seed gives the same result no matter how many threads are used. Chains can optionally
+run on a ladder of temperatures and swap solutions between epochs, parallel tempering style.
 */
 
 #include "OptimizerSolution.h"
 #include "Controller.h"
 #include "Simulator.h"
+#include "SimulationContext.h"
+#include "RobustObjective.h"
+#include "OptimizerEngine.h"
+#include "ParallelFor.h"
 #include <cmath>
 #include <vector>
 #include <iostream>
+#include <random>
+#include <memory>
+#include <ctime>
+#include <limits>
 
 using namespace std;
 
+// What the annealer minimizes. The robust modes score every candidate against the optimizer's list
+// of MECO perturbations.
+enum ObjectiveMode
+{
+    OBJECTIVE_NOMINAL,          //error at the nominal MECO conditions
+    OBJECTIVE_MEAN,             //mean error over the perturbations
+    OBJECTIVE_WORST,            //worst error over the perturbations
+    OBJECTIVE_PERCENTILE        //percentile of the error over the perturbations
+};
+
+// Search algorithm used by GainOptimizer::optimize()
+enum OptimizerEngineType
+{
+    ENGINE_ANNEALING,           //the optimizer's own simulated annealing chains
+    ENGINE_CMAES,
+    ENGINE_NELDER_MEAD,
+    ENGINE_SURROGATE            //RBF model screens candidates before they are flown
+};
+
+// State of one annealing chain
+struct AnnealChain
+{
+    mt19937 rng;                //random number stream used only by this chain
+    Solution currSoln, bestSoln;
+    double currTemp;            //temperature of the annealing schedule, sets the step size
+    double tempScale;           //multiplier on currTemp for acceptance, from the temperature ladder
+};
+
 class GainOptimizer
 {
     public:
-    GainOptimizer();
+    GainOptimizer(int numThreads = 1);
     Solution evaluate();
+    Solution optimize();
+    void setEngine(OptimizerEngineType engineType);
+    void setMaxEvaluations(int maxEvaluations);
+    int getNumEvaluations();
+    int getEvaluationsToConverge();
+    static string engineName(OptimizerEngineType engineType);
     void findPerturbationSolution();
+    void setNumThreads(int numThreads);
+    void setSeed(unsigned int seed);
+    void setNumChains(int numChains);
+    void setExchange(int exchangeInterval, double ladderRatio = 1.5);
+    void setObjective(ObjectiveMode mode);
+    void setPerturbations(const vector<MecoPerturbation>& perturbations, double percentileLevel = 0.9);
+    RobustScore scoreRobust(Solution soln);
+    void setCache(EvaluationCache* cache);
+    void setControlPeriod(double controlPeriod);
+    void setEarlyAbort(bool earlyAbort);
 
     private:
+    const int EPOCH_LENGTH = 25;    //iterations between progress reports when chains do not exchange
+
     int numIterations;
     double initialTemp;
-    Solution bestSoln, currSoln;
     vector<double> bounds;
+    SimulationContext context;
+    vector<unique_ptr<SimulationContext>> workerContexts;   //one per worker thread
+    ObjectiveMode objectiveMode;
+    RobustObjective robustObjective;
+    EvaluationCache* cache;
+    double controlPeriod;       //s, of every simulated flight
+    bool earlyAbort;            //stop nominal flights that can no longer be accepted
+
+    OptimizerEngineType engineType;
+    int maxEvaluations;         //budget of the other engines, 0 matches the annealer's
+    vector<pair<int, double>> progress;     //best score after each number of evaluations
+    int numEvaluations, evaluationsToConverge;
+
+    int numThreads;
+    int numChains;
+    int exchangeInterval;       //iterations between solution swaps, 0 runs independent chains
+    double ladderRatio;         //temperature ratio between neighbouring chains when swapping
+    unsigned int seed;
+    unsigned int runNum;        //counts runs so repeated runs with one seed differ reproducibly
     
-    double objectiveFunction(Solution soln);
-    Solution takeStep(Solution currSoln, double currTemp);
+    vector<Solution> runChains(int numChains, int exchangeInterval);
+    void annealStep(AnnealChain& chain, int iteration, SimulationContext& context, bool chainsParallel);
+    void exchangeSolutions(vector<AnnealChain>& chains, int epochNum, mt19937& exchangeRng);
+    double scheduleTemp(int iteration);
+    double objectiveFunction(Solution soln, SimulationContext& context, bool chainsParallel,
+        double cutoff = numeric_limits<double>::infinity());
+    void printAbortStats();
+    void updateCacheFingerprint();
+    static unique_ptr<OptimizerEngine> createEngine(OptimizerEngineType engineType, int numThreads = 1);
+    void scoreBatch(vector<Solution>& batch);
+    void recordProgress(int evaluations, double bestScore);
+    Solution takeStep(Solution currSoln, double currTemp, mt19937& rng);
     void enforceBounds(Solution& candidateSoln);
-    double height_perturbation = 0;
-    double vel_perturbation = 0;
 
 
 };
@@ -1,80 +1,394 @@
 #include "Generator.h"
+#include "ReferenceArchive.h"
 
-Generator::Generator()
+Generator::Generator(int numThreads, AngleSolverMethod solverMethod)
+    : solver(solverMethod, 0.001)
 {
     tolerance = 0.001;      //0.1 percent
-    maxAngle = MAX_PADDLE_ANGLE;
+    integratorMode = FIXED_STEP;
+    apogeeTolerance = 0.1;  //m
+    incremental = true;
+    warmStart = true;
 
     // starting height and velocity values at MECO obtained from OpenRocket
     seedVelocity = mecoVelocity;        //m/s
     seedHeight = mecoHeight;          //m
+
+    setNumThreads(numThreads);
+}
+
+
+// Sets the number of worker threads used to sweep the grid. A value of 0 or less uses every core.
+void Generator::setNumThreads(int numThreads)
+{
+    this->numThreads = resolveThreadCount(numThreads);
+}
+
+
+// Selects the root finder used to search for the constant paddle angle at each grid point
+void Generator::setSolverMethod(AngleSolverMethod solverMethod)
+{
+    solver.setMethod(solverMethod);
+}
+
+
+// Selects the integrator used for every simulation in the sweep. See Simulator::setIntegrator().
+void Generator::setIntegrator(IntegratorMode mode, double apogeeTolerance)
+{
+    integratorMode = mode;
+    this->apogeeTolerance = apogeeTolerance;
+}
+
+
+// Turns reuse of earlier results on or off. With incremental runs off every grid point is simulated
+// again, but the manifest is still written for the next run.
+void Generator::setIncremental(bool incremental)
+{
+    this->incremental = incremental;
+}
+
+
+// Turns seeding each angle search from the neighbouring grid points on or off. With it off every search
+// starts from the solver's usual bracket.
+void Generator::setWarmStart(bool warmStart)
+{
+    this->warmStart = warmStart;
 }
 
 
 // Brute force solution to generate optimal reference trajectories. A seed height and velocity at 
 // main engine cutoff (MECO) is obtained from OpenRocket, and is used to generate a suite of height
 // and velocity combinations that could potentially be seen in flight. For each combination of height
-// and velocity, and constant paddle angle is found that results in the desired apogee
+// and velocity, and constant paddle angle is found that results in the desired apogee.
+// The grid is swept in height and velocity order so each search can start from its solved neighbours.
+// The lowest velocity column is solved first, moving up in height, then every height row is solved
+// along the velocities starting from its point in that column. Rows only depend on the column, so they
+// are spread over numThreads workers, each point running on its own Simulator. With more threads than
+// rows the serial column would leave most workers idle, so instead every row is cut into segments
+// that start from a cold search and all segments are solved in parallel. Seeds then depend on the
+// number of threads, and angles may differ within the solver tolerance between thread counts. The
+// index file is written after the sweep in grid order. New points are numbered after the points
+// already in the manifest, which on a first run gives each point its grid position.
 void Generator::generateTrajectories()
 {
     vector<double> initialVelocities, initialHeights;
     populateInitialConditions(seedVelocity, seedHeight, initialVelocities, initialHeights);
-    string outputFilename = "";
-    int simNum = 0;
-
-    ofstream indexWriter(REF_DIRECTORY + INDEX_FILE_NAME);
-    if (!indexWriter.is_open())
-    {
-        cout << "Index file not opened in Generator::generateTrajectories()" << endl;
-    }
 
-    //dummy controller object to satisfy argument of Simulator::simulate()
-    Controller dummyController(0,0,0,0,0);
+    map<pair<double, double>, ManifestEntry> manifest = readManifest();
+    int lastSimNum = 0;
+    for (auto& entry : manifest) lastSimNum = max(lastSimNum, entry.second.simNum);
 
+    vector<GridPoint> gridPoints;
+    int numUpToDate = 0;
     for (int i = 0; i < initialHeights.size(); i++)
     {
         for(int j = 0; j < initialVelocities.size(); j++)
         {
-            simNum++;
-            cout << "Sim " << simNum << endl;
-            outputFilename = REF_FILE_BASE + to_string(simNum) + ".txt";
-
-            Simulator currSim(0,0,0);
-            double finalApogee = 0;     //m
-            double deploymentAngle = 10 * (M_PI/180);   //radians
-            double angleStep = 0 * (M_PI/180);   //radians
-            bool keepLooping = true;
-            int numRuns = 0;
-
-            while(keepLooping)
+            GridPoint point;
+            point.height = initialHeights.at(i);
+            point.velocity = initialVelocities.at(j);
+            point.deploymentAngle = 0;
+            point.finalApogee = 0;
+            point.numSimulations = 0;
+            point.converged = false;
+            point.inputHash = hashInputs(point);
+            point.outputHash = 0;
+            point.upToDate = false;
+
+            auto found = manifest.find(make_pair(point.height, point.velocity));
+            if (found == manifest.end()) point.simNum = ++lastSimNum;
+            else
             {
-                numRuns++;
-                keepLooping = false;
-                currSim.reset(initialHeights.at(i), initialVelocities.at(j), deploymentAngle);
-                currSim.simulate(dummyController);
-                finalApogee = currSim.getApogee();
-                double previousAngle = deploymentAngle;
-                adjustAngle(deploymentAngle, angleStep, finalApogee);
-
-                if (deploymentAngle > maxAngle || deploymentAngle < 0)
+                const ManifestEntry& entry = found->second;
+                point.simNum = entry.simNum;
+
+                // reuse the earlier result if nothing it depends on changed and its file is intact
+                string outputFile = REF_DIRECTORY + REF_FILE_BASE + to_string(point.simNum) + ".txt";
+                if (incremental && entry.inputHash == point.inputHash 
+                    && (!entry.converged || hashFile(outputFile) == entry.outputHash))
                 {
-                    cout << "Simulation not possible." << endl;
-                    break;
+                    point.converged = entry.converged;
+                    point.deploymentAngle = entry.deploymentAngle;
+                    point.finalApogee = entry.finalApogee;
+                    point.outputHash = entry.outputHash;
+                    point.upToDate = true;
+                    if (point.converged) point.trajectory = ReferenceStore::readTextTrajectory(point.simNum);
+                    numUpToDate++;
                 }
-
-                // check if angle changed using double comparison method
-                // if the angle changed, loop again
-                if (abs(previousAngle - deploymentAngle) > 0.0001) keepLooping = true;
-            }
-            if (abs(finalApogee - TARGET_APOGEE) < TARGET_APOGEE*tolerance)
-            {
-                currSim.writeRecord(REF_DIRECTORY + outputFilename);
-                indexWriter << initialHeights.at(i) << " " << initialVelocities.at(j) << " " 
-                << REF_FILE_BASE + to_string(simNum) + ".txt";
-                if (simNum < initialHeights.size()*initialVelocities.size()) indexWriter << endl;
             }
+
+            gridPoints.push_back(point);
+        }
+    }
+
+    //dummy controller object to satisfy argument of Simulator::simulate(). It is never asked for an
+    //angle because every simulation uses a fixed paddle angle, so all workers can share it. It must be
+    //created before the index file is truncated below because it reads the index on construction.
+    Controller dummyController(0,0,0,0,0);
+
+    vector<int> heightOrder = sortedOrder(initialHeights);
+    vector<int> velocityOrder = sortedOrder(initialVelocities);
+    auto pointAt = [&](int row, int col) -> GridPoint*
+    {
+        if (row < 0 || col < 0) return nullptr;
+        return &gridPoints.at(heightOrder.at(row)*initialVelocities.size() + velocityOrder.at(col));
+    };
+    // points reused from an earlier run are skipped but still seed their neighbours
+    auto sweepPoint = [&](GridPoint* point, const GridPoint* nearest, const GridPoint* next)
+    {
+        if (!point->upToDate) solvePoint(*point, dummyController, nearest, next);
+    };
+
+    int numRows = heightOrder.size(), numCols = velocityOrder.size();
+    int numSegments = 1;
+    if (numRows > 0 && numThreads > numRows) numSegments = min(numCols, (numThreads + numRows - 1)/numRows);
+
+    int firstCol = 0;
+    if (numSegments == 1)
+    {
+        for (int row = 0; row < numRows; row++)
+        {
+            sweepPoint(pointAt(row, 0), pointAt(row - 1, 0), pointAt(row - 2, 0));
+        }
+        firstCol = 1;
+    }
+    parallelFor(numRows*numSegments, numThreads, [&](int job, int)
+    {
+        int row = job / numSegments, segment = job % numSegments;
+        int start = numCols*segment/numSegments, end = numCols*(segment + 1)/numSegments;
+        for (int col = max(start, firstCol); col < end; col++)
+        {
+            // neighbours in an earlier segment may not be solved yet
+            const GridPoint* nearest = (col - 1 >= start) ? pointAt(row, col - 1) : nullptr;
+            const GridPoint* next = (col - 2 >= start) ? pointAt(row, col - 2) : nullptr;
+            sweepPoint(pointAt(row, col), nearest, next);
+        }
+    });
+
+    // the reference files are written in the background, so wait for them before hashing
+    RecordWriter::instance().flush();
+    for (GridPoint& point : gridPoints)
+    {
+        if (point.upToDate || !point.converged) continue;
+        point.outputHash = hashFile(REF_DIRECTORY + REF_FILE_BASE + to_string(point.simNum) + ".txt");
+    }
+
+    ofstream indexWriter(REF_DIRECTORY + INDEX_FILE_NAME);
+    if (!indexWriter.is_open())
+    {
+        cout << "Index file not opened in Generator::generateTrajectories()" << endl;
+    }
+
+    int numConverged = 0, totalSimulations = 0;
+    vector<ReferenceIndexEntry> archiveIndex;
+    vector<shared_ptr<const ReferenceTrajectory>> archiveTrajectories;
+    for (int k = 0; k < gridPoints.size(); k++)
+    {
+        GridPoint& point = gridPoints.at(k);
+        totalSimulations += point.numSimulations;
+        if (!point.converged) continue;
+        numConverged++;
+
+        indexWriter << point.height << " " << point.velocity << " " 
+        << REF_FILE_BASE + to_string(point.simNum) + ".txt";
+        if (k + 1 < gridPoints.size()) indexWriter << endl;
+
+        archiveIndex.push_back(ReferenceArchive::indexEntryFor(point.simNum, point.height, point.velocity));
+        archiveTrajectories.push_back(point.trajectory);
+    }
+    indexWriter.close();
+
+    // the archive is written after the index so it is never older than the text files it mirrors
+    ReferenceArchive::write(REF_DIRECTORY + ARCHIVE_FILE_NAME, archiveIndex, archiveTrajectories);
+    writeManifest(gridPoints, manifest);
+
+    // cached references are stale now that the files have been rewritten
+    ReferenceStore::instance().clear();
+
+    cout << "Generated " << numConverged << " of " << gridPoints.size() << " trajectories using "
+        << totalSimulations << " simulations (" << AngleSolver::methodName(solver.getMethod()) << ", "
+        << double(totalSimulations)/gridPoints.size() << " per grid point), " << numUpToDate 
+        << " already up to date." << endl;
+}
+
+
+// Searches for the constant paddle angle that brings the rocket to the target apogee from the
+// initial conditions of a single grid point, and writes the reference file if the search converged.
+// nearest and next are the closest solved neighbours along one grid line, used to seed the search.
+// Safe to call from several threads at once as long as each call gets its own GridPoint.
+void Generator::solvePoint(GridPoint& point, Controller& dummyController, const GridPoint* nearest,
+    const GridPoint* next)
+{
+    INSTRUMENT_TIMER(TIME_GRID_POINT);
+    string outputFilename = REF_FILE_BASE + to_string(point.simNum) + ".txt";
+
+    Simulator currSim(0,0,0);
+    currSim.setRecordPolicy(RECORD_DECIMATED, 0.1);     //writeRecord() only keeps 0.1 s spacing
+    currSim.setIntegrator(integratorMode, apogeeTolerance);
+    double lastAngle = -1;
+    function<double(double)> apogeeAt = [&](double deploymentAngle)
+    {
+        currSim.reset(point.height, point.velocity, deploymentAngle);
+        currSim.simulate(dummyController);
+        lastAngle = deploymentAngle;
+        return currSim.getApogee();
+    };
+
+    double angleGuess, angleStep;
+    AngleSolution soln;
+    if (warmStartGuess(point, nearest, next, angleGuess, angleStep)) soln = solver.solve(apogeeAt, angleGuess, angleStep);
+    else soln = solver.solve(apogeeAt);
+    point.deploymentAngle = soln.deploymentAngle;
+    point.finalApogee = soln.finalApogee;
+    point.numSimulations = soln.numSimulations;
+    point.converged = soln.converged;
+    INSTRUMENT_COUNT(COUNT_GRID_POINTS, 1);
+    INSTRUMENT_COUNT(COUNT_GRID_POINT_SIMULATIONS, soln.numSimulations);
+
+    {
+        lock_guard<mutex> lock(outputLock);
+        cout << "Sim " << point.simNum << ": " << soln.numSimulations << " simulations, angle = "
+            << soln.deploymentAngle * (180/M_PI) << " deg, apogee = " << soln.finalApogee << " m" << endl;
+        if (!point.converged) cout << "Simulation not possible." << endl;
+    }
+
+    if (point.converged)
+    {
+        // make sure the recorded flight is the one flown with the chosen angle
+        if (lastAngle != soln.deploymentAngle) apogeeAt(soln.deploymentAngle);
+        currSim.writeRecord(REF_DIRECTORY + outputFilename);
+        point.trajectory = ReferenceArchive::trajectoryFromRecord(point.simNum, currSim.getRecord());
+    }
+}
+
+
+// Extrapolates the paddle angle of point from its neighbours nearest and next, which lie on the same
+// grid line with nearest closer to point. With only one converged neighbour its angle is used as is.
+// angleStep is the first step the warm started search takes away from the guess: a fraction of the
+// extrapolated change, so a good extrapolation is bracketed tightly. Returns false if there is no
+// converged neighbour to start from.
+bool Generator::warmStartGuess(const GridPoint& point, const GridPoint* nearest, const GridPoint* next,
+    double& angleGuess, double& angleStep)
+{
+    const double MIN_STEP = 0.1 * (M_PI/180);   //rad
+    const double SINGLE_STEP = 4 * (M_PI/180);  //rad, step when there is nothing to extrapolate from
+
+    if (!warmStart || !nearest || !nearest->converged) return false;
+
+    angleGuess = nearest->deploymentAngle;
+    angleStep = SINGLE_STEP;
+    if (!next || !next->converged) return true;
+
+    // position along the grid line the three points share
+    bool alongHeight = (nearest->height != point.height);
+    double x = alongHeight ? point.height : point.velocity;
+    double x1 = alongHeight ? nearest->height : nearest->velocity;
+    double x2 = alongHeight ? next->height : next->velocity;
+    if (x1 == x2) return true;
+
+    double change = (nearest->deploymentAngle - next->deploymentAngle)/(x1 - x2) * (x - x1);
+    angleGuess += change;
+    angleStep = max(0.25*abs(change), MIN_STEP);
+    return true;
+}
+
+
+// Returns the positions of values sorted by value
+vector<int> Generator::sortedOrder(const vector<double>& values)
+{
+    vector<int> order(values.size());
+    for (int i = 0; i < order.size(); i++) order.at(i) = i;
+    sort(order.begin(), order.end(), [&](int a, int b) { return values.at(a) < values.at(b); });
+    return order;
+}
+
+
+// Hashes everything the result of a grid point depends on: its MECO conditions, the solver and
+// integrator settings, whether the search was warm started, and the simulator's model (see
+// Simulator::hashModel()). GENERATOR_VERSION must be increased when the search changes in a way
+// these do not show.
+uint64_t Generator::hashInputs(const GridPoint& point)
+{
+    const int GENERATOR_VERSION = 3;
+
+    double values[] = {point.height, point.velocity, tolerance, apogeeTolerance};
+    int settings[] = {GENERATOR_VERSION, int(solver.getMethod()), int(integratorMode), int(warmStart)};
+
+    uint64_t hash = hashBytes(values, sizeof(values));
+    hash = hashBytes(settings, sizeof(settings), hash);
+    return Simulator::hashModel(hash);
+}
+
+
+// Hashes the contents of a file. Returns 0 if the file cannot be read.
+uint64_t Generator::hashFile(const string& filename)
+{
+    ifstream reader(filename, ios::binary);
+    if (!reader.is_open()) return 0;
+
+    uint64_t hash = HASH_SEED;
+    char buffer[65536];
+    while (reader.read(buffer, sizeof(buffer)) || reader.gcount() > 0)
+    {
+        hash = hashBytes(buffer, reader.gcount(), hash);
+    }
+    return hash;
+}
+
+
+// Reads the manifest written by the last run, keyed on MECO height and velocity. Returns an empty map
+// if there is no manifest.
+map<pair<double, double>, ManifestEntry> Generator::readManifest()
+{
+    map<pair<double, double>, ManifestEntry> manifest;
+
+    ifstream reader(REF_DIRECTORY + MANIFEST_FILE_NAME);
+    if (!reader.is_open()) return manifest;
+
+    string line;
+    while (getline(reader, line))
+    {
+        ManifestEntry entry;
+        stringstream parser(line);
+        if (parser >> entry.height >> entry.velocity >> entry.simNum >> hex >> entry.inputHash 
+            >> entry.outputHash >> dec >> entry.converged >> entry.deploymentAngle >> entry.finalApogee)
+        {
+            manifest[make_pair(entry.height, entry.velocity)] = entry;
         }
     }
+    return manifest;
+}
+
+
+// Records the key and result of every grid point. Entries of earlier runs for points that are no longer
+// in the grid are kept so those points get their old file numbers back. Heights and velocities are
+// written with full precision so the next run finds them again.
+void Generator::writeManifest(const vector<GridPoint>& gridPoints, map<pair<double, double>, ManifestEntry>& manifest)
+{
+    ofstream writer(REF_DIRECTORY + MANIFEST_FILE_NAME);
+    if (!writer.is_open())
+    {
+        cout << "Manifest file not opened in Generator::writeManifest()" << endl;
+        return;
+    }
+
+    writer.precision(17);
+    for (int k = 0; k < gridPoints.size(); k++)
+    {
+        const GridPoint& point = gridPoints.at(k);
+        writer << point.height << " " << point.velocity << " " << point.simNum << " " << hex 
+            << point.inputHash << " " << point.outputHash << " " << dec << point.converged << " " 
+            << point.deploymentAngle << " " << point.finalApogee << endl;
+        manifest.erase(make_pair(point.height, point.velocity));
+    }
+
+    for (auto& found : manifest)
+    {
+        const ManifestEntry& entry = found.second;
+        writer << entry.height << " " << entry.velocity << " " << entry.simNum << " " << hex 
+            << entry.inputHash << " " << entry.outputHash << " " << dec << entry.converged << " " 
+            << entry.deploymentAngle << " " << entry.finalApogee << endl;
+    }
 }
 
 
@@ -101,19 +415,3 @@ void Generator::populateInitialConditions(double seedVel, double seedHeight,
         velocities.push_back(seedVel - i*VELOCITY_STEP);
     }
 }
-
-
-// Increase or decrease the selected deployment angle for the next simulation depending on the results
-// of the previous simulation. A variable angle step is used to reduce computation time
-void Generator::adjustAngle(double& deploymentAngle, double& angleStep, double finalApogee)
-{
-    // adjust angle step based on how close the simulation is to the target
-    if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.5) angleStep = 3 * (M_PI/180);
-    else if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.25) angleStep = 1 * (M_PI/180);
-    else if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.1) angleStep = 0.5 * (M_PI/180);
-    else /*if (abs(finalApogee - TARGET_APOGEE) > TARGET_APOGEE*0.03)*/ angleStep = 0.05 * (M_PI/180);
-
-    // adjust deployment angle up if the rocket overshot the target, else adjust down
-    if (finalApogee > TARGET_APOGEE*(1+tolerance)) deploymentAngle += angleStep;
-    else if (finalApogee < TARGET_APOGEE*(1-tolerance)) deploymentAngle -= angleStep;
-}
\ No newline at end of file
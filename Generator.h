@@ -8,28 +8,86 @@ Description: Class that uses the Simulator class to generate an optimal referenc
 the PID controller. This is a brute force solution that tries imposing a constant paddle deployment
 angle over the whole flight. The chosen angle is adjusted until the target apogee is reached, then flight
 information is recorded to be used as a reference by the PID controller.
+Runs are incremental. Each grid point is keyed on a hash of everything its result depends on, and a
+manifest next to the index records the key, result and output file hash of every point. Points whose
+key and output file still match are not simulated again, and points keep their file numbers when the
+grid is extended.
+The sweep walks the grid in height and velocity order and seeds each angle search with an angle
+extrapolated from the one or two neighbouring points already solved, so on a dense grid most points
+need only one or two simulations.
 */
 
 #include "Simulator.h"
 #include "Controller.h"
 #include "consts.h"
+#include "ParallelFor.h"
+#include "AngleSolver.h"
+#include "ReferenceStore.h"
+#include "Hashing.h"
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <mutex>
+#include <map>
+#include <cstdint>
 
 using namespace std;
 
+// Initial conditions and results for one (height, velocity) combination in the generator grid
+struct GridPoint
+{
+    double height, velocity;     //MECO height (m) and velocity (m/s)
+    int simNum;                  //number used in the refDataN.txt file name
+    double deploymentAngle;      //constant paddle angle found by the search, rad
+    double finalApogee;          //apogee reached with that angle, m
+    int numSimulations;          //number of simulations used by the angle search
+    bool converged;
+    shared_ptr<const ReferenceTrajectory> trajectory;     //written reference, kept for the archive
+    uint64_t inputHash;          //hash of every input the result depends on
+    uint64_t outputHash;         //hash of the reference file, 0 if there is none
+    bool upToDate;               //result reused from an earlier run
+};
+
+// One line of the manifest: the key and result of a grid point from an earlier run
+struct ManifestEntry
+{
+    double height, velocity;
+    int simNum;
+    uint64_t inputHash, outputHash;
+    bool converged;
+    double deploymentAngle, finalApogee;
+};
+
 class Generator
 {
     public:
-    Generator();
+    Generator(int numThreads = 1, AngleSolverMethod solverMethod = BRENT);
     void generateTrajectories();
+    void setNumThreads(int numThreads);
+    void setSolverMethod(AngleSolverMethod solverMethod);
+    void setIntegrator(IntegratorMode mode, double apogeeTolerance = 0.1);
+    void setIncremental(bool incremental);
+    void setWarmStart(bool warmStart);
 
     private:
-    vector<Simulator*> simulations;
-    double tolerance, maxAngle, seedHeight, seedVelocity;
+    int numThreads;
+    double tolerance, seedHeight, seedVelocity;
+    AngleSolver solver;
+    IntegratorMode integratorMode;
+    double apogeeTolerance;     //m, only used by the adaptive integrator
+    mutex outputLock;
+    bool incremental;           //reuse up to date results from the manifest
+    bool warmStart;             //seed each search from its solved neighbours
     void populateInitialConditions(double, double, vector<double>&, vector<double>&);
-    void adjustAngle(double& deploymentAngle, double& angleStep, double finalApogee);
+    void solvePoint(GridPoint& point, Controller& dummyController, const GridPoint* nearest = nullptr,
+        const GridPoint* next = nullptr);
+    bool warmStartGuess(const GridPoint& point, const GridPoint* nearest, const GridPoint* next,
+        double& angleGuess, double& angleStep);
+    static vector<int> sortedOrder(const vector<double>& values);
+    uint64_t hashInputs(const GridPoint& point);
+    map<pair<double, double>, ManifestEntry> readManifest();
+    void writeManifest(const vector<GridPoint>& gridPoints, map<pair<double, double>, ManifestEntry>& manifest);
+    static uint64_t hashFile(const string& filename);
 
 };
 
@@ -0,0 +1,31 @@
+#ifndef HASHING_H
+#define HASHING_H
+
+/*
+File: Hashing.h
+Author: Gerritt Graham
+Description: 64-bit FNV-1a hashing used to fingerprint the inputs of saved results, such as the
+Generator's manifest and the EvaluationCache file. Hashes are chained by passing the previous hash
+back in, so several blocks of data can be folded into one fingerprint. Values are hashed by their
+bytes, so fingerprints are only comparable between builds for the same platform.
+*/
+
+#include <cstdint>
+#include <cstddef>
+
+const uint64_t HASH_SEED = 14695981039346656037ULL;     //FNV-1a offset basis
+
+// Hashes a block of bytes, continuing from hash
+inline uint64_t hashBytes(const void* data, size_t numBytes, uint64_t hash = HASH_SEED)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < numBytes; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+#endif //HASHING_H
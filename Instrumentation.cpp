@@ -0,0 +1,146 @@
+#include "Instrumentation.h"
+
+#ifdef SIM_INSTRUMENTATION
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+
+// Slots of every thread that has recorded anything, kept after the thread exits
+static mutex registryLock;
+static vector<unique_ptr<ThreadInstruments>> registry;
+
+static ThreadInstruments* registerThread()
+{
+    unique_ptr<ThreadInstruments> slot(new ThreadInstruments());
+    for (int i = 0; i < NUM_COUNTERS; i++) slot->counts[i] = 0;
+    for (int i = 0; i < NUM_TIMERS; i++) slot->timeNs[i] = slot->timerCalls[i] = 0;
+
+    lock_guard<mutex> lock(registryLock);
+    registry.push_back(move(slot));
+    return registry.back().get();
+}
+
+
+// Returns the calling thread's slots, registering them on first use
+ThreadInstruments& Instrumentation::local()
+{
+    thread_local ThreadInstruments* slot = registerThread();
+    return *slot;
+}
+
+
+void Instrumentation::addTime(InstrumentTimer timer, long long ns)
+{
+    ThreadInstruments& slot = local();
+    slot.timeNs[timer].store(slot.timeNs[timer].load(memory_order_relaxed) + ns, memory_order_relaxed);
+    slot.timerCalls[timer].store(slot.timerCalls[timer].load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+
+// Zeroes every thread's counters and timers
+void Instrumentation::reset()
+{
+    lock_guard<mutex> lock(registryLock);
+    for (auto& slot : registry)
+    {
+        for (int i = 0; i < NUM_COUNTERS; i++) slot->counts[i] = 0;
+        for (int i = 0; i < NUM_TIMERS; i++) slot->timeNs[i] = slot->timerCalls[i] = 0;
+    }
+}
+
+
+const char* Instrumentation::counterName(InstrumentCounter counter)
+{
+    const char* names[NUM_COUNTERS] = {"simulations", "integration_steps", "controller_calls",
+        "reference_lookups", "file_loads", "lines_parsed", "files_written", "grid_points",
+        "grid_point_simulations", "anneal_accepted", "anneal_rejected", "anneal_aborted"};
+    return names[counter];
+}
+
+
+const char* Instrumentation::timerName(InstrumentTimer timer)
+{
+    const char* names[NUM_TIMERS] = {"simulation", "controller", "file_load", "record_write",
+        "grid_point", "objective"};
+    return names[timer];
+}
+
+
+// Sums every thread's counters and timers, prints a summary and writes the same figures as JSON to
+// jsonFilename. Physics time is simulation time less the controller time spent inside it.
+void Instrumentation::report(const string& jsonFilename)
+{
+    long long counts[NUM_COUNTERS] = {}, timeNs[NUM_TIMERS] = {}, timerCalls[NUM_TIMERS] = {};
+    int numThreads;
+    {
+        lock_guard<mutex> lock(registryLock);
+        numThreads = registry.size();
+        for (auto& slot : registry)
+        {
+            for (int i = 0; i < NUM_COUNTERS; i++) counts[i] += slot->counts[i].load(memory_order_relaxed);
+            for (int i = 0; i < NUM_TIMERS; i++)
+            {
+                timeNs[i] += slot->timeNs[i].load(memory_order_relaxed);
+                timerCalls[i] += slot->timerCalls[i].load(memory_order_relaxed);
+            }
+        }
+    }
+
+    auto ratio = [](double numerator, double denominator) { return (denominator > 0) ? numerator/denominator : 0.0; };
+    long long annealDecisions = counts[COUNT_ANNEAL_ACCEPTED] + counts[COUNT_ANNEAL_REJECTED] + counts[COUNT_ANNEAL_ABORTED];
+    const int NUM_DERIVED = 6;
+    const char* derivedNames[NUM_DERIVED] = {"physics_s", "physics_ns_per_step", "steps_per_simulation",
+        "simulations_per_grid_point", "anneal_acceptance_rate", "anneal_abort_rate"};
+    double derived[NUM_DERIVED] = {
+        1e-9*(timeNs[TIME_SIMULATION] - timeNs[TIME_CONTROLLER]),
+        ratio(timeNs[TIME_SIMULATION] - timeNs[TIME_CONTROLLER], counts[COUNT_INTEGRATION_STEPS]),
+        ratio(counts[COUNT_INTEGRATION_STEPS], counts[COUNT_SIMULATIONS]),
+        ratio(counts[COUNT_GRID_POINT_SIMULATIONS], counts[COUNT_GRID_POINTS]),
+        ratio(counts[COUNT_ANNEAL_ACCEPTED], annealDecisions),
+        ratio(counts[COUNT_ANNEAL_ABORTED], annealDecisions)};
+
+    cout << "Instrumentation report (" << numThreads << " threads)" << endl;
+    for (int i = 0; i < NUM_COUNTERS; i++)
+    {
+        if (counts[i] != 0) cout << "  " << counterName(InstrumentCounter(i)) << ": " << counts[i] << endl;
+    }
+    for (int i = 0; i < NUM_TIMERS; i++)
+    {
+        if (timerCalls[i] == 0) continue;
+        cout << "  " << timerName(InstrumentTimer(i)) << ": " << 1e-9*timeNs[i] << " s over " << timerCalls[i]
+            << " calls (" << ratio(timeNs[i], timerCalls[i]) << " ns each)" << endl;
+    }
+    for (int i = 0; i < NUM_DERIVED; i++)
+    {
+        if (derived[i] != 0) cout << "  " << derivedNames[i] << ": " << derived[i] << endl;
+    }
+
+    ofstream writer(jsonFilename);
+    if (!writer.is_open())
+    {
+        cout << "Report file " << jsonFilename << " did not open in Instrumentation::report()." << endl;
+        return;
+    }
+    writer << "{" << endl << "  \"threads\": " << numThreads << "," << endl << "  \"counters\": {";
+    for (int i = 0; i < NUM_COUNTERS; i++)
+    {
+        writer << (i ? ", " : "") << "\"" << counterName(InstrumentCounter(i)) << "\": " << counts[i];
+    }
+    writer << "}," << endl << "  \"timers\": {";
+    for (int i = 0; i < NUM_TIMERS; i++)
+    {
+        writer << (i ? ", " : "") << "\"" << timerName(InstrumentTimer(i)) << "\": {\"seconds\": "
+            << 1e-9*timeNs[i] << ", \"calls\": " << timerCalls[i] << "}";
+    }
+    writer << "}," << endl << "  \"derived\": {";
+    for (int i = 0; i < NUM_DERIVED; i++)
+    {
+        writer << (i ? ", " : "") << "\"" << derivedNames[i] << "\": " << derived[i];
+    }
+    writer << "}" << endl << "}" << endl;
+}
+
+#endif //SIM_INSTRUMENTATION
@@ -0,0 +1,112 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+/*
+File: Instrumentation.h
+Author: Gerritt Graham
+Description: Optional counters and scoped timers for the hot paths, used to see where the time of a
+long Generator or GainOptimizer run goes. Everything is compiled out unless SIM_INSTRUMENTATION is
+defined (e.g. g++ -DSIM_INSTRUMENTATION ...), in which case the INSTRUMENT_ macros below expand to
+updates of per-thread slots, so threads never contend. The slots of finished threads are kept, and
+INSTRUMENT_REPORT() sums every thread into a text summary and a JSON file. Reports are meant to be
+made once the workers are done; a report made while they run is still safe but may be slightly behind.
+Timers cost a clock read at each end (tens of ns), which is noticeable on short calls such as
+Controller::calcAngle. Controller time is part of simulation time, so physics time is the difference.
+*/
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+enum InstrumentCounter
+{
+    COUNT_SIMULATIONS,
+    COUNT_INTEGRATION_STEPS,
+    COUNT_CONTROLLER_CALLS,
+    COUNT_REFERENCE_LOOKUPS,        //trajectories requested from the ReferenceStore
+    COUNT_FILE_LOADS,               //reference and index files read from disk
+    COUNT_LINES_PARSED,
+    COUNT_FILES_WRITTEN,
+    COUNT_GRID_POINTS,
+    COUNT_GRID_POINT_SIMULATIONS,   //simulations used by the Generator's angle searches
+    COUNT_ANNEAL_ACCEPTED,
+    COUNT_ANNEAL_REJECTED,
+    COUNT_ANNEAL_ABORTED,           //candidates whose flight was stopped once it could not be accepted
+    NUM_COUNTERS
+};
+
+enum InstrumentTimer
+{
+    TIME_SIMULATION,
+    TIME_CONTROLLER,
+    TIME_FILE_LOAD,
+    TIME_RECORD_WRITE,
+    TIME_GRID_POINT,
+    TIME_OBJECTIVE,
+    NUM_TIMERS
+};
+
+#ifdef SIM_INSTRUMENTATION
+
+// Counters and timer totals of one thread. Only the owning thread changes them; relaxed atomics let
+// a report read them at any time without a data race and without locked instructions on updates.
+struct ThreadInstruments
+{
+    atomic<long long> counts[NUM_COUNTERS];
+    atomic<long long> timeNs[NUM_TIMERS];
+    atomic<long long> timerCalls[NUM_TIMERS];
+};
+
+class Instrumentation
+{
+    public:
+    static ThreadInstruments& local();
+    static void add(InstrumentCounter counter, long long amount)
+    {
+        atomic<long long>& count = local().counts[counter];
+        count.store(count.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+    static void addTime(InstrumentTimer timer, long long ns);
+    static void report(const string& jsonFilename);
+    static void reset();
+    static const char* counterName(InstrumentCounter counter);
+    static const char* timerName(InstrumentTimer timer);
+
+};
+
+// Adds the time from construction to destruction to a timer
+class ScopedTimer
+{
+    public:
+    ScopedTimer(InstrumentTimer timer) : timer(timer), start(chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        Instrumentation::addTime(timer, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+    InstrumentTimer timer;
+    chrono::steady_clock::time_point start;
+
+};
+
+#define INSTRUMENT_JOIN_NAME(a, b) a##b
+#define INSTRUMENT_TIMER_NAME(line) INSTRUMENT_JOIN_NAME(instrumentTimer, line)
+#define INSTRUMENT_COUNT(counter, amount) Instrumentation::add(counter, amount)
+#define INSTRUMENT_TIMER(timer) ScopedTimer INSTRUMENT_TIMER_NAME(__LINE__)(timer)
+#define INSTRUMENT_REPORT(jsonFilename) Instrumentation::report(jsonFilename)
+
+#else
+
+#define INSTRUMENT_COUNT(counter, amount) ((void)0)
+#define INSTRUMENT_TIMER(timer) ((void)0)
+#define INSTRUMENT_REPORT(jsonFilename) ((void)0)
+
+#endif //SIM_INSTRUMENTATION
+
+
+#endif //INSTRUMENTATION_H
@@ -0,0 +1,138 @@
+#include "NelderMeadEngine.h"
+
+NelderMeadEngine::NelderMeadEngine(double initialSize)
+{
+    this->initialSize = initialSize;
+    minSize = 1e-6;
+}
+
+
+string NelderMeadEngine::getName()
+{
+    return "Nelder-Mead";
+}
+
+
+// Standard Nelder-Mead with reflection 1, expansion 2, contraction 0.5 and shrink 0.5. The search is
+// deterministic, so the random generator is not used.
+Solution NelderMeadEngine::optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+    Solution startSoln, int maxEvaluations, mt19937&)
+{
+    const int N = 3;
+    int numEvaluations = 0;
+
+    // score one normalized point
+    auto scorePoint = [&](vector<double>& x)
+    {
+        clampToUnitCube(x);
+        vector<Solution> batch = {denormalize(x, bounds)};
+        scoreBatch(batch);
+        numEvaluations++;
+        return batch.at(0);
+    };
+
+    // starting simplex: the start point plus a step along each axis, stepping inward at an upper bound
+    vector<vector<double>> points(N + 1, normalize(startSoln, bounds));
+    clampToUnitCube(points.at(0));
+    for (int i = 0; i < N; i++)
+    {
+        points.at(i + 1) = points.at(0);
+        double step = (points.at(0).at(i) + initialSize <= 1) ? initialSize : -initialSize;
+        points.at(i + 1).at(i) += step;
+    }
+    vector<Solution> vertices(N + 1);
+    for (int i = 0; i <= N; i++) vertices.at(i) = denormalize(points.at(i), bounds);
+    scoreBatch(vertices);
+    numEvaluations += N + 1;
+
+    vector<int> order(N + 1);
+    while (numEvaluations < maxEvaluations)
+    {
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(),
+            [&](int a, int b) { return vertices.at(a).score < vertices.at(b).score; });
+        int best = order.at(0), worst = order.at(N), secondWorst = order.at(N - 1);
+
+        double size = 0;
+        for (int i = 0; i <= N; i++)
+        {
+            for (int j = 0; j < N; j++) size = max(size, abs(points.at(i).at(j) - points.at(best).at(j)));
+        }
+        if (size < minSize) break;
+
+        vector<double> centroid(N, 0);
+        for (int i = 0; i <= N; i++)
+        {
+            if (i == worst) continue;
+            for (int j = 0; j < N; j++) centroid.at(j) += points.at(i).at(j)/N;
+        }
+        auto along = [&](double coefficient)
+        {
+            vector<double> x(N);
+            for (int j = 0; j < N; j++) x.at(j) = centroid.at(j) + coefficient*(points.at(worst).at(j) - centroid.at(j));
+            return x;
+        };
+
+        vector<double> reflected = along(-1);
+        Solution reflectedSoln = scorePoint(reflected);
+        if (reflectedSoln.score < vertices.at(best).score)
+        {
+            if (numEvaluations >= maxEvaluations)
+            {
+                points.at(worst) = reflected;
+                vertices.at(worst) = reflectedSoln;
+                break;
+            }
+            vector<double> expanded = along(-2);
+            Solution expandedSoln = scorePoint(expanded);
+            if (expandedSoln.score < reflectedSoln.score)
+            {
+                points.at(worst) = expanded;
+                vertices.at(worst) = expandedSoln;
+            }
+            else
+            {
+                points.at(worst) = reflected;
+                vertices.at(worst) = reflectedSoln;
+            }
+            continue;
+        }
+        if (reflectedSoln.score < vertices.at(secondWorst).score)
+        {
+            points.at(worst) = reflected;
+            vertices.at(worst) = reflectedSoln;
+            continue;
+        }
+        if (numEvaluations >= maxEvaluations) break;
+
+        // contract toward the better of the worst point and its reflection
+        bool outside = reflectedSoln.score < vertices.at(worst).score;
+        vector<double> contracted = along(outside ? -0.5 : 0.5);
+        Solution contractedSoln = scorePoint(contracted);
+        if (contractedSoln.score < min(reflectedSoln.score, vertices.at(worst).score))
+        {
+            points.at(worst) = contracted;
+            vertices.at(worst) = contractedSoln;
+            continue;
+        }
+        if (numEvaluations + N > maxEvaluations) break;
+
+        // shrink every point toward the best one and score them as one batch
+        vector<Solution> shrunk;
+        vector<int> shrunkPoints;
+        for (int i = 0; i <= N; i++)
+        {
+            if (i == best) continue;
+            for (int j = 0; j < N; j++) points.at(i).at(j) = points.at(best).at(j) + 0.5*(points.at(i).at(j) - points.at(best).at(j));
+            shrunk.push_back(denormalize(points.at(i), bounds));
+            shrunkPoints.push_back(i);
+        }
+        scoreBatch(shrunk);
+        numEvaluations += N;
+        for (int k = 0; k < N; k++) vertices.at(shrunkPoints.at(k)) = shrunk.at(k);
+    }
+
+    Solution bestSoln = vertices.at(0);
+    for (int i = 1; i <= N; i++) if (vertices.at(i).score < bestSoln.score) bestSoln = vertices.at(i);
+    return bestSoln;
+}
@@ -0,0 +1,37 @@
+#ifndef NELDER_MEAD_ENGINE_H
+#define NELDER_MEAD_ENGINE_H
+
+/*
+File: NelderMeadEngine.h
+Author: Gerritt Graham
+Description: Nelder-Mead simplex search for tuning the PID gains. A simplex of four points in the
+normalized gain space is reflected, expanded and contracted away from its worst point. It needs no
+step size tuning and few evaluations on smooth objectives, but most moves score a single point, so
+only the initial simplex and shrink steps are scored as parallel batches. Points are clamped onto the
+bounds.
+*/
+
+#include "OptimizerEngine.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+class NelderMeadEngine : public OptimizerEngine
+{
+    public:
+    NelderMeadEngine(double initialSize = 0.1);
+    string getName();
+    Solution optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+        Solution startSoln, int maxEvaluations, mt19937& rng);
+
+    private:
+    double initialSize;         //edge length of the starting simplex in normalized units
+    double minSize;             //stops once the simplex is this small
+
+};
+
+
+#endif //NELDER_MEAD_ENGINE_H
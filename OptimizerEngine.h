@@ -0,0 +1,64 @@
+#ifndef OPTIMIZER_ENGINE_H
+#define OPTIMIZER_ENGINE_H
+
+/*
+File: OptimizerEngine.h
+Author: Gerritt Graham
+Description: Common interface for the search algorithms the GainOptimizer can use to tune the PID gains.
+An engine proposes candidate gains and hands them to the optimizer in batches, which scores every
+Solution in the batch with the optimizer's objective, in parallel when there are spare threads. Engines
+work in gain space normalized to [0, 1] by the optimizer's bounds and must keep every candidate inside
+the bounds.
+*/
+
+#include "OptimizerSolution.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <random>
+
+using namespace std;
+
+// Scores every Solution in the batch in place
+typedef function<void(vector<Solution>&)> BatchObjective;
+
+class OptimizerEngine
+{
+    public:
+    virtual ~OptimizerEngine() {}
+    virtual string getName() = 0;
+
+    // Minimizes the objective starting from startSoln, using at most maxEvaluations scored
+    // candidates. bounds holds the lower and upper limit of kp, ki and kd in that order.
+    virtual Solution optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+        Solution startSoln, int maxEvaluations, mt19937& rng) = 0;
+
+    protected:
+    // Helpers to move between gains and the normalized [0, 1] cube
+    static vector<double> normalize(const Solution& soln, const vector<double>& bounds)
+    {
+        return {(soln.kp - bounds.at(0))/(bounds.at(1) - bounds.at(0)),
+                (soln.ki - bounds.at(2))/(bounds.at(3) - bounds.at(2)),
+                (soln.kd - bounds.at(4))/(bounds.at(5) - bounds.at(4))};
+    }
+    static Solution denormalize(const vector<double>& x, const vector<double>& bounds)
+    {
+        Solution soln;
+        soln.setGains(bounds.at(0) + x.at(0)*(bounds.at(1) - bounds.at(0)),
+                      bounds.at(2) + x.at(1)*(bounds.at(3) - bounds.at(2)),
+                      bounds.at(4) + x.at(2)*(bounds.at(5) - bounds.at(4)));
+        return soln;
+    }
+    static void clampToUnitCube(vector<double>& x)
+    {
+        for (int i = 0; i < x.size(); i++)
+        {
+            if (x.at(i) < 0) x.at(i) = 0;
+            else if (x.at(i) > 1) x.at(i) = 1;
+        }
+    }
+
+};
+
+
+#endif //OPTIMIZER_ENGINE_H
@@ -0,0 +1,56 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+/*
+File: ParallelFor.h
+Author: Gerritt Graham
+Description: Small helper for running independent jobs across a fixed number of worker threads.
+Jobs are handed out in index order from a shared counter, so each job runs exactly once no matter
+how many workers are used. Callers are responsible for writing results into per-job slots so the
+output order stays deterministic.
+*/
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+// Returns the number of worker threads to use. A request of 0 or less means "use every core".
+inline int resolveThreadCount(int requestedThreads)
+{
+    if (requestedThreads > 0) return requestedThreads;
+    int hardwareThreads = thread::hardware_concurrency();
+    return (hardwareThreads > 0) ? hardwareThreads : 1;
+}
+
+
+// Runs job(index, workerNum) for every index in [0, numJobs). The worker number is in
+// [0, numThreads) and can be used to pick per-thread scratch objects. With one thread the jobs
+// run on the calling thread.
+inline void parallelFor(int numJobs, int numThreads, const function<void(int, int)>& job)
+{
+    numThreads = resolveThreadCount(numThreads);
+    if (numThreads > numJobs) numThreads = numJobs;
+
+    if (numThreads <= 1)
+    {
+        for (int i = 0; i < numJobs; i++) job(i, 0);
+        return;
+    }
+
+    atomic<int> nextJob(0);
+    vector<thread> workers;
+    for (int w = 0; w < numThreads; w++)
+    {
+        workers.emplace_back([&, w]()
+        {
+            for (int i = nextJob++; i < numJobs; i = nextJob++) job(i, w);
+        });
+    }
+    for (int w = 0; w < numThreads; w++) workers.at(w).join();
+}
+
+
+#endif //PARALLEL_FOR_H
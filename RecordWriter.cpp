@@ -0,0 +1,93 @@
+#include "RecordWriter.h"
+
+// Returns the single writer shared by the whole process
+RecordWriter& RecordWriter::instance()
+{
+    static RecordWriter writer;
+    return writer;
+}
+
+
+// Writes every record still in the queue, then stops the worker thread
+RecordWriter::~RecordWriter()
+{
+    {
+        lock_guard<mutex> lock(queueLock);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+
+// Queues record to be written to filename and returns straight away. The worker thread is started
+// the first time a record is submitted. Records that FlightRecord::write() would refuse are reported
+// here, on the caller's thread, and dropped.
+void RecordWriter::submit(const string& filename, FlightRecord&& record)
+{
+    if (!record.isWritable()) return;
+
+    PendingRecord pending;
+    pending.filename = filename;
+    pending.record = move(record);
+    time(&pending.createdTime);
+
+    {
+        lock_guard<mutex> lock(queueLock);
+        queue.push_back(move(pending));
+        if (!worker.joinable()) worker = thread(&RecordWriter::run, this);
+    }
+    queueChanged.notify_all();
+}
+
+
+// Blocks until every record submitted so far has been written
+void RecordWriter::flush()
+{
+    unique_lock<mutex> lock(queueLock);
+    queueChanged.wait(lock, [&]() { return queue.empty() && !writing; });
+}
+
+
+// Worker thread: writes queued records in submission order until the writer is destroyed
+void RecordWriter::run()
+{
+    unique_lock<mutex> lock(queueLock);
+    while (true)
+    {
+        queueChanged.wait(lock, [&]() { return !queue.empty() || stopping; });
+        if (queue.empty()) return;     //stopping and nothing left to write
+
+        PendingRecord pending = move(queue.front());
+        queue.pop_front();
+        writing = true;
+        lock.unlock();
+
+        writeFile(pending);
+
+        lock.lock();
+        writing = false;
+        queueChanged.notify_all();
+    }
+}
+
+
+// Formats a whole record into the reused buffer and writes it with a single call
+void RecordWriter::writeFile(PendingRecord& pending)
+{
+    INSTRUMENT_TIMER(TIME_RECORD_WRITE);
+    INSTRUMENT_COUNT(COUNT_FILES_WRITTEN, 1);
+    const size_t BUFFER_SIZE = 1 << 20;     //bytes, grows if a record needs more
+
+    if (buffer.capacity() < BUFFER_SIZE) buffer.reserve(BUFFER_SIZE);
+    buffer.clear();
+    pending.record.format(buffer, pending.createdTime);
+
+    ofstream writer(pending.filename);
+    if (!writer.is_open())
+    {
+        cout << "Output file " << pending.filename << " did not open in RecordWriter::writeFile()." << endl;
+        return;
+    }
+    writer.write(buffer.data(), buffer.size());
+}
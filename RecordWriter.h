@@ -0,0 +1,61 @@
+#ifndef RECORD_WRITER_H
+#define RECORD_WRITER_H
+
+/*
+File: RecordWriter.h
+Author: Gerritt Graham
+Description: Background writer for flight record files. Simulation threads hand finished records to
+the writer through a queue and carry on, while a single writer thread formats each record into one
+large buffer (see FlightRecord::format()) and writes it to disk in a single call. The files are
+identical in content to the ones FlightRecord::write() produces. Callers that read a file back must
+call flush() first. The queue is emptied before the process exits.
+*/
+
+#include "FlightRecord.h"
+#include "Instrumentation.h"
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <ctime>
+
+using namespace std;
+
+class RecordWriter
+{
+    public:
+    static RecordWriter& instance();
+    void submit(const string& filename, FlightRecord&& record);
+    void flush();
+    ~RecordWriter();
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    private:
+    // A record waiting to be written, with the time it was submitted for the file header
+    struct PendingRecord
+    {
+        string filename;
+        FlightRecord record;
+        time_t createdTime;
+    };
+
+    RecordWriter() {}
+    mutex queueLock;
+    condition_variable queueChanged;
+    deque<PendingRecord> queue;
+    thread worker;
+    bool writing = false;       //the worker is writing a record it has taken off the queue
+    bool stopping = false;
+    string buffer;              //only used by the worker thread
+
+    void run();
+    void writeFile(PendingRecord& pending);
+
+};
+
+
+#endif //RECORD_WRITER_H
@@ -0,0 +1,259 @@
+#include "ReferenceArchive.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ReferenceArchive::ReferenceArchive()
+{
+    mapping = nullptr;
+    mappingSize = 0;
+    isMapped = false;
+    header = nullptr;
+    entries = nullptr;
+}
+
+
+ReferenceArchive::~ReferenceArchive()
+{
+#ifndef _WIN32
+    if (isMapped) munmap((void*)mapping, mappingSize);
+    else delete[] mapping;
+#else
+    delete[] mapping;
+#endif
+}
+
+
+// Maps the archive file into memory. Returns nullptr if the file does not exist or is not a valid
+// archive. On systems without mmap the file is read into memory in one piece instead.
+shared_ptr<ReferenceArchive> ReferenceArchive::open(const string& filename)
+{
+    INSTRUMENT_TIMER(TIME_FILE_LOAD);
+    INSTRUMENT_COUNT(COUNT_FILE_LOADS, 1);
+    shared_ptr<ReferenceArchive> archive(new ReferenceArchive());
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(ArchiveHeader))
+    {
+        close(fd);
+        return nullptr;
+    }
+    archive->mappingSize = fileInfo.st_size;
+    void* mapped = mmap(nullptr, archive->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return nullptr;
+    archive->mapping = (const char*)mapped;
+    archive->isMapped = true;
+#else
+    ifstream reader(filename, ios::binary | ios::ate);
+    if (!reader.is_open()) return nullptr;
+    archive->mappingSize = reader.tellg();
+    if (archive->mappingSize < sizeof(ArchiveHeader)) return nullptr;
+    char* buffer = new char[archive->mappingSize];
+    archive->mapping = buffer;
+    reader.seekg(0);
+    reader.read(buffer, archive->mappingSize);
+#endif
+
+    if (!archive->validate())
+    {
+        cout << "Invalid reference archive " << filename << " in ReferenceArchive::open()." << endl;
+        return nullptr;
+    }
+    return archive;
+}
+
+
+// Checks the header and that every entry's data lies inside the file
+bool ReferenceArchive::validate()
+{
+    header = (const ArchiveHeader*)mapping;
+    if (strncmp(header->magic, "REFTRAJ", 8) != 0) return false;
+    if (header->version != FORMAT_VERSION || header->fileSize != mappingSize) return false;
+
+    uint64_t entriesEnd = sizeof(ArchiveHeader) + uint64_t(header->numTrajectories)*sizeof(ArchiveEntry);
+    if (entriesEnd > mappingSize) return false;
+    entries = (const ArchiveEntry*)(mapping + sizeof(ArchiveHeader));
+
+    for (int i = 0; i < header->numTrajectories; i++)
+    {
+        uint64_t dataEnd = entries[i].dataOffset + 4*uint64_t(entries[i].numSamples)*sizeof(double);
+        if (entries[i].dataOffset % sizeof(double) != 0 || dataEnd > mappingSize) return false;
+    }
+    return true;
+}
+
+
+int ReferenceArchive::getNumTrajectories()
+{
+    return header->numTrajectories;
+}
+
+
+// Builds the index entries from the archive, in the order they were written
+shared_ptr<const vector<ReferenceIndexEntry>> ReferenceArchive::getIndex()
+{
+    shared_ptr<vector<ReferenceIndexEntry>> index = make_shared<vector<ReferenceIndexEntry>>();
+    index->reserve(header->numTrajectories);
+    for (int i = 0; i < header->numTrajectories; i++)
+    {
+        ReferenceIndexEntry entry;
+        entry.height = entries[i].height;
+        entry.velocity = entries[i].velocity;
+        entry.trajectoryNum = entries[i].trajectoryNum;
+        entry.fileName = REF_FILE_BASE + to_string(entry.trajectoryNum) + ".txt";
+        index->push_back(entry);
+    }
+    return index;
+}
+
+
+// Returns a trajectory whose arrays point straight into the archive. The trajectory keeps the archive
+// mapped for as long as it is alive. Returns nullptr if the archive does not hold trajectoryNum.
+shared_ptr<const ReferenceTrajectory> ReferenceArchive::getTrajectory(int trajectoryNum)
+{
+    for (int i = 0; i < header->numTrajectories; i++)
+    {
+        if (entries[i].trajectoryNum != trajectoryNum) continue;
+
+        const double* data = (const double*)(mapping + entries[i].dataOffset);
+        return make_shared<const ReferenceTrajectory>(trajectoryNum, entries[i].numSamples, data,
+            shared_from_this());
+    }
+    return nullptr;
+}
+
+
+// Writes the index entries and their trajectories to a new archive file. trajectories must be in the
+// same order as index.
+bool ReferenceArchive::write(const string& filename, const vector<ReferenceIndexEntry>& index,
+    const vector<shared_ptr<const ReferenceTrajectory>>& trajectories)
+{
+    if (index.size() != trajectories.size())
+    {
+        cout << "Index and trajectory counts differ in ReferenceArchive::write()." << endl;
+        return false;
+    }
+
+    ArchiveHeader fileHeader;
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    strncpy(fileHeader.magic, "REFTRAJ", sizeof(fileHeader.magic));
+    fileHeader.version = FORMAT_VERSION;
+    fileHeader.numTrajectories = index.size();
+
+    // lay out the data after the entries, keeping every channel 8 byte aligned
+    vector<ArchiveEntry> fileEntries(index.size());
+    uint64_t offset = sizeof(ArchiveHeader) + index.size()*sizeof(ArchiveEntry);
+    offset = (offset + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    uint64_t dataStart = offset;
+    for (int i = 0; i < index.size(); i++)
+    {
+        memset(&fileEntries.at(i), 0, sizeof(ArchiveEntry));
+        fileEntries.at(i).height = index.at(i).height;
+        fileEntries.at(i).velocity = index.at(i).velocity;
+        fileEntries.at(i).trajectoryNum = index.at(i).trajectoryNum;
+        fileEntries.at(i).numSamples = trajectories.at(i)->numSamples;
+        fileEntries.at(i).dataOffset = offset;
+        offset += 4*uint64_t(trajectories.at(i)->numSamples)*sizeof(double);
+    }
+    fileHeader.fileSize = offset;
+
+    ofstream writer(filename, ios::binary | ios::trunc);
+    if (!writer.is_open())
+    {
+        cout << "Archive file did not open in ReferenceArchive::write()." << endl;
+        return false;
+    }
+
+    writer.write((const char*)&fileHeader, sizeof(fileHeader));
+    if (!fileEntries.empty()) writer.write((const char*)fileEntries.data(), fileEntries.size()*sizeof(ArchiveEntry));
+    uint64_t written = sizeof(fileHeader) + fileEntries.size()*sizeof(ArchiveEntry);
+    const char padding[sizeof(double)] = {0};
+    writer.write(padding, dataStart - written);
+
+    for (int i = 0; i < trajectories.size(); i++)
+    {
+        const ReferenceTrajectory& trajectory = *trajectories.at(i);
+        size_t channelBytes = trajectory.numSamples*sizeof(double);
+        writer.write((const char*)trajectory.times, channelBytes);
+        writer.write((const char*)trajectory.heights, channelBytes);
+        writer.write((const char*)trajectory.velocities, channelBytes);
+        writer.write((const char*)trajectory.accels, channelBytes);
+    }
+
+    return writer.good();
+}
+
+
+// Converts the text reference set in REF_DIRECTORY (index.txt and its refDataN.txt files) into an
+// archive next to it
+bool ReferenceArchive::convertTextReferences()
+{
+    shared_ptr<const vector<ReferenceIndexEntry>> index = ReferenceStore::readTextIndex();
+    vector<shared_ptr<const ReferenceTrajectory>> trajectories;
+    for (int i = 0; i < index->size(); i++)
+    {
+        trajectories.push_back(ReferenceStore::readTextTrajectory(index->at(i).trajectoryNum));
+    }
+
+    bool success = write(REF_DIRECTORY + ARCHIVE_FILE_NAME, *index, trajectories);
+    if (success)
+    {
+        cout << "Converted " << index->size() << " reference trajectories to " 
+            << REF_DIRECTORY + ARCHIVE_FILE_NAME << endl;
+    }
+    return success;
+}
+
+
+// Rounds a value to the precision the text record files are written with
+static double roundLikeText(double value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%g", value);
+    return strtod(buffer, nullptr);
+}
+
+
+// Builds the reference trajectory that reading the record back from a text file would give: samples
+// spaced 0.1 s apart, as written by FlightRecord::write(), with values rounded to the same precision.
+// Used by the Generator to write the archive straight from memory.
+shared_ptr<const ReferenceTrajectory> ReferenceArchive::trajectoryFromRecord(int trajectoryNum, FlightRecord& record)
+{
+    FlightRecord spaced = record.decimate(0.1);
+    vector<double> times, heights, velocities, accels;
+    for (int i = 0; i < spaced.size(); i++)
+    {
+        times.push_back(roundLikeText(spaced.timeVals.at(i)));
+        heights.push_back(roundLikeText(spaced.heightVals.at(i)));
+        velocities.push_back(roundLikeText(spaced.velocityVals.at(i)));
+        accels.push_back(roundLikeText(spaced.accelVals.at(i)));
+    }
+    return make_shared<const ReferenceTrajectory>(trajectoryNum, times, heights, velocities, accels);
+}
+
+
+// Builds the index entry that reading the index file back would give for a trajectory generated
+// from the given MECO conditions
+ReferenceIndexEntry ReferenceArchive::indexEntryFor(int trajectoryNum, double height, double velocity)
+{
+    ReferenceIndexEntry entry;
+    entry.height = roundLikeText(height);
+    entry.velocity = roundLikeText(velocity);
+    entry.fileName = REF_FILE_BASE + to_string(trajectoryNum) + ".txt";
+    entry.trajectoryNum = trajectoryNum;
+    return entry;
+}
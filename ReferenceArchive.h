@@ -0,0 +1,74 @@
+#ifndef REFERENCE_ARCHIVE_H
+#define REFERENCE_ARCHIVE_H
+
+/*
+File: ReferenceArchive.h
+Author: Gerritt Graham
+Description: Binary container holding the whole set of reference trajectories and their index. The
+file starts with a header, followed by one fixed-size entry per trajectory (MECO height and velocity,
+trajectory number, sample count and data offset), followed by each trajectory's time, height,
+velocity and acceleration channels as contiguous doubles. The file is memory mapped and used in place,
+so loading it needs no parsing. Values are stored with the same precision as the text files, so
+either format gives identical reference trajectories. The format uses the byte order of the machine
+that wrote it.
+*/
+
+#include "consts.h"
+#include "ReferenceStore.h"
+#include "FlightRecord.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+struct ArchiveHeader
+{
+    char magic[8];              //"REFTRAJ" and a terminating 0
+    uint32_t version;
+    uint32_t numTrajectories;
+    uint64_t fileSize;          //bytes, used to detect truncated files
+};
+
+struct ArchiveEntry
+{
+    double height, velocity;    //MECO conditions, m and m/s
+    int32_t trajectoryNum;
+    uint32_t numSamples;
+    uint64_t dataOffset;        //bytes from the start of the file to the first time value
+};
+
+class ReferenceArchive : public enable_shared_from_this<ReferenceArchive>
+{
+    public:
+    static shared_ptr<ReferenceArchive> open(const string& filename);
+    static bool write(const string& filename, const vector<ReferenceIndexEntry>& index,
+        const vector<shared_ptr<const ReferenceTrajectory>>& trajectories);
+    static bool convertTextReferences();
+    static shared_ptr<const ReferenceTrajectory> trajectoryFromRecord(int trajectoryNum, FlightRecord& record);
+    static ReferenceIndexEntry indexEntryFor(int trajectoryNum, double height, double velocity);
+    ReferenceArchive(const ReferenceArchive&) = delete;
+    ReferenceArchive& operator=(const ReferenceArchive&) = delete;
+    ~ReferenceArchive();
+
+    int getNumTrajectories();
+    shared_ptr<const vector<ReferenceIndexEntry>> getIndex();
+    shared_ptr<const ReferenceTrajectory> getTrajectory(int trajectoryNum);
+
+    private:
+    static const uint32_t FORMAT_VERSION = 1;
+
+    ReferenceArchive();
+    const char* mapping;        //start of the mapped (or, without mmap, loaded) file
+    size_t mappingSize;
+    bool isMapped;
+    const ArchiveHeader* header;
+    const ArchiveEntry* entries;
+
+    bool validate();
+
+};
+
+
+#endif //REFERENCE_ARCHIVE_H
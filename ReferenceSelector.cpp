@@ -0,0 +1,208 @@
+#include "ReferenceSelector.h"
+
+// Builds the tree from the index entries. Each axis is scaled by its range across the index so that
+// height and velocity differences count the same in the distance.
+ReferenceSelector::ReferenceSelector(const vector<ReferenceIndexEntry>& index)
+{
+    scale[0] = scale[1] = 1;
+    root = -1;
+    if (index.empty()) return;
+
+    double minHeight = index.at(0).height, maxHeight = index.at(0).height;
+    double minVelocity = index.at(0).velocity, maxVelocity = index.at(0).velocity;
+    for (int i = 1; i < index.size(); i++)
+    {
+        minHeight = min(minHeight, index.at(i).height);
+        maxHeight = max(maxHeight, index.at(i).height);
+        minVelocity = min(minVelocity, index.at(i).velocity);
+        maxVelocity = max(maxVelocity, index.at(i).velocity);
+    }
+    if (maxHeight > minHeight) scale[0] = maxHeight - minHeight;
+    if (maxVelocity > minVelocity) scale[1] = maxVelocity - minVelocity;
+
+    vector<Node> points(index.size());
+    for (int i = 0; i < index.size(); i++)
+    {
+        points.at(i).key[0] = index.at(i).height / scale[0];
+        points.at(i).key[1] = index.at(i).velocity / scale[1];
+        points.at(i).trajectoryNum = index.at(i).trajectoryNum;
+    }
+
+    nodes.reserve(points.size());
+    root = build(points, 0, points.size(), 0);
+}
+
+
+// Recursively splits points[first, last) at the median of the current axis and returns the node
+// holding the median
+int ReferenceSelector::build(vector<Node>& points, int first, int last, int depth)
+{
+    if (first >= last) return -1;
+
+    int axis = depth % 2;
+    int middle = first + (last - first)/2;
+    nth_element(points.begin() + first, points.begin() + middle, points.begin() + last,
+        [axis](const Node& a, const Node& b) { return a.key[axis] < b.key[axis]; });
+
+    int nodeNum = nodes.size();
+    nodes.push_back(points.at(middle));
+    nodes.at(nodeNum).axis = axis;
+
+    int left = build(points, first, middle, depth + 1);
+    int right = build(points, middle + 1, last, depth + 1);
+    nodes.at(nodeNum).left = left;
+    nodes.at(nodeNum).right = right;
+    return nodeNum;
+}
+
+
+int ReferenceSelector::size() const
+{
+    return nodes.size();
+}
+
+
+// Finds up to numNeighbours index entries closest to the given MECO height (m) and velocity (m/s).
+// neighbours is filled closest first.
+void ReferenceSelector::findNearest(double h0, double V0, int numNeighbours,
+    vector<ReferenceNeighbour>& neighbours) const
+{
+    neighbours.clear();
+    if (root < 0 || numNeighbours <= 0) return;
+
+    double query[2] = {h0 / scale[0], V0 / scale[1]};
+    search(root, query, numNeighbours, neighbours);
+}
+
+
+// Visits the subtree under node, keeping best sorted by distance and at most numNeighbours long.
+// The far side of a split is only searched if it could hold a closer entry than the worst kept.
+void ReferenceSelector::search(int node, const double query[2], int numNeighbours,
+    vector<ReferenceNeighbour>& best) const
+{
+    if (node < 0) return;
+    const Node& curr = nodes.at(node);
+
+    double dx = query[0] - curr.key[0];
+    double dy = query[1] - curr.key[1];
+    ReferenceNeighbour candidate;
+    candidate.trajectoryNum = curr.trajectoryNum;
+    candidate.distance = sqrt(dx*dx + dy*dy);
+
+    if (best.size() < numNeighbours || candidate.distance < best.back().distance)
+    {
+        auto position = upper_bound(best.begin(), best.end(), candidate,
+            [](const ReferenceNeighbour& a, const ReferenceNeighbour& b) { return a.distance < b.distance; });
+        best.insert(position, candidate);
+        if (best.size() > numNeighbours) best.pop_back();
+    }
+
+    double split = query[curr.axis] - curr.key[curr.axis];
+    int nearSide = (split < 0) ? curr.left : curr.right;
+    int farSide = (split < 0) ? curr.right : curr.left;
+    search(nearSide, query, numNeighbours, best);
+    if (best.size() < numNeighbours || abs(split) < best.back().distance)
+    {
+        search(farSide, query, numNeighbours, best);
+    }
+}
+
+
+// Blends the numNeighbours trajectories closest to the given MECO conditions into one reference.
+// Weights follow the modified Shepard rule ((R - d)/(R d))^2, where R is the distance to the next
+// closest entry, so an entry's weight reaches zero just as it drops out of the neighbourhood. The
+// blend is sampled every BLEND_TIME_STEP seconds from the earliest start time and each trajectory
+// holds its first and last samples outside its own time span. If the conditions match an entry or
+// only one entry has weight, that trajectory is returned as is. Blended trajectories have trajectory
+// number -1.
+shared_ptr<const ReferenceTrajectory> ReferenceSelector::blend(double h0, double V0, int numNeighbours) const
+{
+    vector<ReferenceNeighbour> neighbours;
+    findNearest(h0, V0, numNeighbours + 1, neighbours);
+    if (neighbours.empty()) return nullptr;
+
+    ReferenceStore& store = ReferenceStore::instance();
+    if (neighbours.at(0).distance < 1e-12) return store.getTrajectory(neighbours.at(0).trajectoryNum);
+
+    // the extra neighbour sets the edge of the neighbourhood. If the whole index fits in the
+    // neighbourhood there is no edge to cross, so every entry keeps some weight.
+    double radius;
+    if (neighbours.size() > numNeighbours)
+    {
+        radius = neighbours.back().distance;
+        neighbours.pop_back();
+    }
+    else radius = 2*neighbours.back().distance;
+
+    vector<shared_ptr<const ReferenceTrajectory>> sources;
+    vector<double> weights;
+    double totalWeight = 0;
+    for (int i = 0; i < neighbours.size(); i++)
+    {
+        double d = neighbours.at(i).distance;
+        if (d >= radius) break;
+        double weight = pow((radius - d)/(radius*d), 2);
+
+        shared_ptr<const ReferenceTrajectory> source = store.getTrajectory(neighbours.at(i).trajectoryNum);
+        if (source->numSamples == 0) continue;
+        sources.push_back(source);
+        weights.push_back(weight);
+        totalWeight += weight;
+    }
+    if (sources.empty()) return store.getTrajectory(neighbours.at(0).trajectoryNum);
+    if (sources.size() == 1) return sources.at(0);
+
+    double startTime = sources.at(0)->times[0], endTime = sources.at(0)->times[sources.at(0)->numSamples - 1];
+    for (int i = 1; i < sources.size(); i++)
+    {
+        startTime = min(startTime, sources.at(i)->times[0]);
+        endTime = max(endTime, sources.at(i)->times[sources.at(i)->numSamples - 1]);
+    }
+
+    vector<double> times, heights, velocities, accels;
+    int numSamples = int((endTime - startTime)/BLEND_TIME_STEP) + 1;
+    times.reserve(numSamples);
+    heights.assign(numSamples, 0);
+    velocities.assign(numSamples, 0);
+    accels.assign(numSamples, 0);
+    for (int k = 0; k < numSamples; k++) times.push_back(startTime + k*BLEND_TIME_STEP);
+
+    // sample every source on the common time grid with a forward cursor
+    for (int i = 0; i < sources.size(); i++)
+    {
+        const ReferenceTrajectory& source = *sources.at(i);
+        double weight = weights.at(i)/totalWeight;
+        int cursor = 0;
+        for (int k = 0; k < numSamples; k++)
+        {
+            double t = times.at(k);
+            while (cursor < source.numSamples && source.times[cursor] <= t) cursor++;
+
+            double h, V, a;
+            if (cursor == 0)
+            {
+                h = source.heights[0];
+                V = source.velocities[0];
+                a = source.accels[0];
+            }
+            else if (cursor == source.numSamples)
+            {
+                h = source.heights[cursor-1];
+                V = source.velocities[cursor-1];
+                a = source.accels[cursor-1];
+            }
+            else
+            {
+                double fraction = (t - source.times[cursor-1]) / (source.times[cursor] - source.times[cursor-1]);
+                h = source.heights[cursor-1] + fraction*(source.heights[cursor] - source.heights[cursor-1]);
+                V = source.velocities[cursor-1] + fraction*(source.velocities[cursor] - source.velocities[cursor-1]);
+                a = source.accels[cursor-1] + fraction*(source.accels[cursor] - source.accels[cursor-1]);
+            }
+            heights.at(k) += weight*h;
+            velocities.at(k) += weight*V;
+            accels.at(k) += weight*a;
+        }
+    }
+
+    return make_shared<const ReferenceTrajectory>(-1, times, heights, velocities, accels);
+}
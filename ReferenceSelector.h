@@ -0,0 +1,58 @@
+#ifndef REFERENCE_SELECTOR_H
+#define REFERENCE_SELECTOR_H
+
+/*
+File: ReferenceSelector.h
+Author: Gerritt Graham
+Description: Spatial index over the MECO conditions of the reference trajectories. The index entries
+are stored in a 2-d tree on height and velocity, each scaled by its range across the index, so the
+nearest trajectories to any MECO condition are found without scanning the whole index. The selector
+can also blend the nearest trajectories into a single interpolated reference with weights that fall
+to zero at the edge of each neighbourhood, so the blended reference changes smoothly as the MECO
+conditions cross from one grid cell into the next.
+*/
+
+#include "ReferenceStore.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// One result of a nearest neighbour query
+struct ReferenceNeighbour
+{
+    int trajectoryNum;
+    double distance;        //scaled distance from the query point
+};
+
+class ReferenceSelector
+{
+    public:
+    ReferenceSelector(const vector<ReferenceIndexEntry>& index);
+    int size() const;
+    void findNearest(double h0, double V0, int numNeighbours, vector<ReferenceNeighbour>& neighbours) const;
+    shared_ptr<const ReferenceTrajectory> blend(double h0, double V0, int numNeighbours) const;
+
+    private:
+    const double BLEND_TIME_STEP = 0.1;     //s, same spacing as the reference files
+
+    struct Node
+    {
+        double key[2];          //scaled height and velocity
+        int trajectoryNum;
+        int left, right;        //child nodes, -1 if none
+        int axis;               //0 splits on height, 1 on velocity
+    };
+    vector<Node> nodes;
+    int root;
+    double scale[2];            //m and m/s per unit of scaled distance
+
+    int build(vector<Node>& points, int first, int last, int depth);
+    void search(int node, const double query[2], int numNeighbours, vector<ReferenceNeighbour>& best) const;
+
+};
+
+
+#endif //REFERENCE_SELECTOR_H
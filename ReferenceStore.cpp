@@ -0,0 +1,272 @@
+#include "ReferenceStore.h"
+#include "ReferenceArchive.h"
+#include "ReferenceSelector.h"
+#include "TextReader.h"
+#include <sys/stat.h>
+
+// Copies the four channels of a trajectory into a single contiguous buffer
+ReferenceTrajectory::ReferenceTrajectory(int trajectoryNum, const vector<double>& times,
+    const vector<double>& heights, const vector<double>& velocities, const vector<double>& accels)
+{
+    this->trajectoryNum = trajectoryNum;
+    numSamples = times.size();
+
+    storage.reserve(4*numSamples);
+    storage.insert(storage.end(), times.begin(), times.end());
+    storage.insert(storage.end(), heights.begin(), heights.end());
+    storage.insert(storage.end(), velocities.begin(), velocities.end());
+    storage.insert(storage.end(), accels.begin(), accels.end());
+
+    this->times = storage.data();
+    this->heights = storage.data() + numSamples;
+    this->velocities = storage.data() + 2*numSamples;
+    this->accels = storage.data() + 3*numSamples;
+}
+
+
+// Takes over channels, which holds numSamples values per channel back to back
+ReferenceTrajectory::ReferenceTrajectory(int trajectoryNum, vector<double>&& channels, int numSamples)
+{
+    this->trajectoryNum = trajectoryNum;
+    this->numSamples = numSamples;
+    storage = move(channels);
+
+    times = storage.data();
+    heights = storage.data() + numSamples;
+    velocities = storage.data() + 2*numSamples;
+    accels = storage.data() + 3*numSamples;
+}
+
+
+// Points the four channels into data, which holds numSamples values per channel back to back.
+// owner is kept alive for as long as the trajectory is.
+ReferenceTrajectory::ReferenceTrajectory(int trajectoryNum, int numSamples, const double* data,
+    shared_ptr<const void> owner)
+{
+    this->trajectoryNum = trajectoryNum;
+    this->numSamples = numSamples;
+    this->owner = owner;
+
+    times = data;
+    heights = data + numSamples;
+    velocities = data + 2*numSamples;
+    accels = data + 3*numSamples;
+}
+
+
+// Returns the single store shared by the whole process
+ReferenceStore& ReferenceStore::instance()
+{
+    static ReferenceStore store;
+    return store;
+}
+
+
+// Returns the trajectory stored in refDataN.txt, where N is trajectoryNum, reading it from disk
+// only the first time it is requested. If the file cannot be read an empty trajectory is returned
+// and the load is retried on the next request.
+shared_ptr<const ReferenceTrajectory> ReferenceStore::getTrajectory(int trajectoryNum)
+{
+    INSTRUMENT_COUNT(COUNT_REFERENCE_LOOKUPS, 1);
+    lock_guard<mutex> lock(storeLock);
+
+    auto found = trajectories.find(trajectoryNum);
+    if (found != trajectories.end()) return found->second;
+
+    openArchive();
+    shared_ptr<const ReferenceTrajectory> trajectory;
+    if (archive) trajectory = archive->getTrajectory(trajectoryNum);
+    if (!trajectory) trajectory = readTextTrajectory(trajectoryNum);
+    if (trajectory->numSamples > 0) trajectories[trajectoryNum] = trajectory;
+    return trajectory;
+}
+
+
+// Returns the entries of the index file, reading it from disk only the first time it is requested
+shared_ptr<const vector<ReferenceIndexEntry>> ReferenceStore::getIndex()
+{
+    lock_guard<mutex> lock(storeLock);
+
+    loadIndex();
+    return index;
+}
+
+
+// Hashes the reference data the store hands out, continuing from hash: every index entry and the
+// samples of the trajectory it names, in index order. The hash is the same whether the trajectories
+// come from the text files or the archive. Reads every trajectory that is not loaded yet.
+uint64_t ReferenceStore::fingerprint(uint64_t hash)
+{
+    shared_ptr<const vector<ReferenceIndexEntry>> entries = getIndex();
+    for (const ReferenceIndexEntry& entry : *entries)
+    {
+        double meco[] = {entry.height, entry.velocity};
+        hash = hashBytes(meco, sizeof(meco), hash);
+        hash = hashBytes(&entry.trajectoryNum, sizeof(entry.trajectoryNum), hash);
+
+        shared_ptr<const ReferenceTrajectory> trajectory = getTrajectory(entry.trajectoryNum);
+        size_t channelBytes = trajectory->numSamples * sizeof(double);
+        hash = hashBytes(&trajectory->numSamples, sizeof(trajectory->numSamples), hash);
+        for (const double* channel : {trajectory->times, trajectory->heights, trajectory->velocities,
+            trajectory->accels})
+        {
+            hash = hashBytes(channel, channelBytes, hash);
+        }
+    }
+    return hash;
+}
+
+
+// Returns the spatial index over the MECO conditions of the index entries, building it the first
+// time it is requested
+shared_ptr<const ReferenceSelector> ReferenceStore::getSelector()
+{
+    lock_guard<mutex> lock(storeLock);
+
+    if (!selector)
+    {
+        loadIndex();
+        selector = make_shared<const ReferenceSelector>(*index);
+    }
+    return selector;
+}
+
+
+// Drops every cached trajectory and the index so they are read again on the next request. Used after
+// the Generator rewrites the reference files. Data already handed out stays valid for its borrowers.
+void ReferenceStore::clear()
+{
+    lock_guard<mutex> lock(storeLock);
+
+    trajectories.clear();
+    index.reset();
+    selector.reset();
+    archive.reset();
+    archiveChecked = false;
+}
+
+
+// Opens the reference archive the first time it is needed. The archive is skipped if it is older than
+// the index file, which means the text references were regenerated after it was written.
+void ReferenceStore::openArchive()
+{
+    if (archiveChecked) return;
+    archiveChecked = true;
+
+    string archiveName = REF_DIRECTORY + ARCHIVE_FILE_NAME;
+    struct stat archiveInfo, indexInfo;
+    if (stat(archiveName.c_str(), &archiveInfo) != 0) return;
+    if (stat((REF_DIRECTORY + INDEX_FILE_NAME).c_str(), &indexInfo) == 0
+        && indexInfo.st_mtime > archiveInfo.st_mtime) return;
+
+    archive = ReferenceArchive::open(archiveName);
+}
+
+
+// Reads the index from the archive, or from the text index file if there is no archive, unless it
+// has already been read. Must be called with storeLock held.
+void ReferenceStore::loadIndex()
+{
+    if (index) return;
+
+    openArchive();
+    if (archive) index = archive->getIndex();
+    else index = readTextIndex();
+}
+
+
+// Reads refDataN.txt, where N is trajectoryNum. Returns an empty trajectory if the file cannot be read.
+// The four channels are parsed straight into one buffer sized from the number of lines. Columns after
+// the acceleration are ignored, blank lines are skipped, and lines without four numbers are reported
+// and skipped.
+shared_ptr<const ReferenceTrajectory> ReferenceStore::readTextTrajectory(int trajectoryNum)
+{
+    INSTRUMENT_TIMER(TIME_FILE_LOAD);
+    INSTRUMENT_COUNT(COUNT_FILE_LOADS, 1);
+    TextReader reader(REF_DIRECTORY + REF_FILE_BASE + to_string(trajectoryNum) + ".txt");
+    if(!reader.isOpen())
+    {
+        cout << "Data file " << trajectoryNum << " failed to open in ReferenceStore::readTextTrajectory()." << endl;
+        return make_shared<const ReferenceTrajectory>(trajectoryNum, vector<double>(), 0);
+    }
+
+    reader.skipLines(REF_HEADER_SIZE);
+    size_t maxSamples = reader.countRemainingLines();
+    vector<double> channels(4*maxSamples);
+    double* times = channels.data();
+    double* heights = times + maxSamples;
+    double* velocities = heights + maxSamples;
+    double* accels = velocities + maxSamples;
+
+    int numSamples = 0;
+    while(reader.nextLine())
+    {
+        if (reader.lineIsBlank()) continue;
+        if (!(reader.readNumber(times[numSamples]) && reader.readNumber(heights[numSamples])
+            && reader.readNumber(velocities[numSamples]) && reader.readNumber(accels[numSamples])))
+        {
+            reader.reportMalformed("ReferenceStore::readTextTrajectory()");
+            continue;   //the next line overwrites whatever was read
+        }
+        numSamples++;
+    }
+    INSTRUMENT_COUNT(COUNT_LINES_PARSED, numSamples);
+
+    // close the gaps left by skipped lines so the channels are back to back
+    if (numSamples < maxSamples)
+    {
+        for (int k = 1; k < 4; k++)
+        {
+            copy(channels.begin() + k*maxSamples, channels.begin() + k*maxSamples + numSamples,
+                channels.begin() + k*numSamples);
+        }
+        channels.resize(4*numSamples);
+    }
+
+    return make_shared<const ReferenceTrajectory>(trajectoryNum, move(channels), numSamples);
+}
+
+
+// Reads the text index file. Returns an empty index if the file cannot be read.
+shared_ptr<const vector<ReferenceIndexEntry>> ReferenceStore::readTextIndex()
+{
+    INSTRUMENT_TIMER(TIME_FILE_LOAD);
+    INSTRUMENT_COUNT(COUNT_FILE_LOADS, 1);
+    shared_ptr<vector<ReferenceIndexEntry>> entries = make_shared<vector<ReferenceIndexEntry>>();
+
+    TextReader reader(REF_DIRECTORY + INDEX_FILE_NAME);
+    if(!reader.isOpen())
+    {
+        cout << "Index file failed to open in ReferenceStore::readTextIndex()." << endl;
+        return entries;
+    }
+
+    // each line is "height velocity refDataN.txt"
+    ReferenceIndexEntry entry;
+    while(reader.nextLine())
+    {
+        if (reader.lineIsBlank()) continue;
+
+        string_view fileName;
+        bool valid = reader.readNumber(entry.height) && reader.readNumber(entry.velocity)
+            && reader.readToken(fileName) && fileName.substr(0, REF_FILE_BASE.length()) == REF_FILE_BASE;
+        if (valid)
+        {
+            const char* numberStart = fileName.data() + REF_FILE_BASE.length();
+            const char* fileNameEnd = fileName.data() + fileName.length();
+            from_chars_result result = from_chars(numberStart, fileNameEnd, entry.trajectoryNum);
+            valid = (result.ec == errc() && result.ptr < fileNameEnd && *result.ptr == '.');
+        }
+        if (!valid)
+        {
+            reader.reportMalformed("ReferenceStore::readTextIndex()");
+            continue;
+        }
+
+        entry.fileName = string(fileName);
+        entries->push_back(entry);
+    }
+    INSTRUMENT_COUNT(COUNT_LINES_PARSED, entries->size());
+
+    return entries;
+}
@@ -0,0 +1,92 @@
+#ifndef REFERENCE_STORE_H
+#define REFERENCE_STORE_H
+
+/*
+File: ReferenceStore.h
+Author: Gerritt Graham
+Description: Process-wide cache of the reference trajectories written by the Generator class. The
+index file and each refDataN.txt file are read from disk once, the first time they are requested,
+and are then shared read-only by every Controller and Simulator. If a binary reference archive (see
+ReferenceArchive.h) at least as new as the index file is present, it is memory mapped and used
+instead of the text files. Text files are parsed in place by TextReader. Trajectories are handed out
+as shared pointers to const data so they stay valid for their borrowers even if the store is
+cleared.
+*/
+
+#include "consts.h"
+#include "Instrumentation.h"
+#include "Hashing.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+class ReferenceArchive;
+class ReferenceSelector;
+
+// Reference flight data for a single trajectory. The four channels are stored back to back in one
+// contiguous buffer and share the same sample numbering. The buffer is either owned by the trajectory
+// or borrowed from a mapped archive, which owner keeps alive.
+class ReferenceTrajectory
+{
+    public:
+    ReferenceTrajectory(int trajectoryNum, const vector<double>& times, const vector<double>& heights,
+        const vector<double>& velocities, const vector<double>& accels);
+    ReferenceTrajectory(int trajectoryNum, vector<double>&& channels, int numSamples);
+    ReferenceTrajectory(int trajectoryNum, int numSamples, const double* data, shared_ptr<const void> owner);
+    ReferenceTrajectory(const ReferenceTrajectory&) = delete;
+    ReferenceTrajectory& operator=(const ReferenceTrajectory&) = delete;
+
+    int trajectoryNum;
+    int numSamples;
+    const double *times, *heights, *velocities, *accels;
+
+    private:
+    vector<double> storage;
+    shared_ptr<const void> owner;
+
+};
+
+// One line of the index file: the MECO conditions a trajectory was generated from
+struct ReferenceIndexEntry
+{
+    double height, velocity;    //m, m/s
+    string fileName;
+    int trajectoryNum;
+};
+
+class ReferenceStore
+{
+    public:
+    static ReferenceStore& instance();
+    shared_ptr<const ReferenceTrajectory> getTrajectory(int trajectoryNum);
+    shared_ptr<const vector<ReferenceIndexEntry>> getIndex();
+    shared_ptr<const ReferenceSelector> getSelector();
+    uint64_t fingerprint(uint64_t hash = HASH_SEED);
+    void clear();
+    static shared_ptr<const ReferenceTrajectory> readTextTrajectory(int trajectoryNum);
+    static shared_ptr<const vector<ReferenceIndexEntry>> readTextIndex();
+
+    private:
+    ReferenceStore() {}
+    mutex storeLock;
+    map<int, shared_ptr<const ReferenceTrajectory>> trajectories;
+    shared_ptr<const vector<ReferenceIndexEntry>> index;
+    shared_ptr<const ReferenceSelector> selector;
+    shared_ptr<ReferenceArchive> archive;
+    bool archiveChecked = false;
+
+    void openArchive();
+    void loadIndex();
+
+};
+
+
+#endif //REFERENCE_STORE_H
@@ -0,0 +1,138 @@
+#include "RobustObjective.h"
+
+RobustObjective::RobustObjective(const vector<MecoPerturbation>& perturbations, double percentileLevel)
+{
+    setPerturbations(perturbations, percentileLevel);
+    cache = nullptr;
+    controlPeriod = 0;
+}
+
+
+// Replaces the list of perturbations. percentileLevel is the fraction (0 to 1) used for
+// RobustScore::percentile.
+void RobustObjective::setPerturbations(const vector<MecoPerturbation>& perturbations, double percentileLevel)
+{
+    this->perturbations = perturbations;
+    this->percentileLevel = percentileLevel;
+}
+
+
+int RobustObjective::getNumPerturbations()
+{
+    return perturbations.size();
+}
+
+
+// Attaches a cache of flight scores to the worker contexts
+void RobustObjective::setCache(EvaluationCache* cache)
+{
+    this->cache = cache;
+    for (int i = 0; i < contexts.size(); i++) contexts.at(i)->setCache(cache);
+}
+
+
+// Sets the control period of the worker contexts, see SimulationContext::setControlPeriod(). Contexts
+// passed to the single context evaluate() keep their own.
+void RobustObjective::setControlPeriod(double controlPeriod)
+{
+    this->controlPeriod = controlPeriod;
+    for (int i = 0; i < contexts.size(); i++) contexts.at(i)->setControlPeriod(controlPeriod);
+}
+
+
+// Flies every perturbation concurrently on numThreads workers. Not safe to call from several threads
+// at once because the worker contexts are shared; use the single context version for that.
+RobustScore RobustObjective::evaluate(const Solution& soln, int numThreads)
+{
+    numThreads = min(resolveThreadCount(numThreads), int(perturbations.size()));
+    while (contexts.size() < max(numThreads, 1))
+    {
+        contexts.push_back(make_unique<SimulationContext>());
+        contexts.back()->setCache(cache);
+        contexts.back()->setControlPeriod(controlPeriod);
+    }
+
+    vector<double> scores(perturbations.size());
+    parallelFor(perturbations.size(), numThreads, [&](int i, int workerNum)
+    {
+        scores.at(i) = scoreFlight(soln, perturbations.at(i), *contexts.at(workerNum));
+    });
+    return summarize(scores);
+}
+
+
+// Flies every perturbation one after another on the given context. Safe to call from several
+// threads at once as long as each passes its own context.
+RobustScore RobustObjective::evaluate(const Solution& soln, SimulationContext& context)
+{
+    vector<double> scores(perturbations.size());
+    for (int i = 0; i < perturbations.size(); i++)
+    {
+        scores.at(i) = scoreFlight(soln, perturbations.at(i), context);
+    }
+    return summarize(scores);
+}
+
+
+double RobustObjective::scoreFlight(const Solution& soln, const MecoPerturbation& perturbation, 
+    SimulationContext& context)
+{
+    return context.scoreGains(soln.kp, soln.ki, soln.kd, 
+        mecoHeight+perturbation.height, mecoVelocity+perturbation.velocity);
+}
+
+
+// Computes the mean, the worst score and the nearest-rank percentile. Reorders scores.
+RobustScore RobustObjective::summarize(vector<double>& scores)
+{
+    RobustScore result;
+    result.mean = result.worst = result.percentile = 0;
+    if (scores.empty()) return result;
+
+    double sum = 0;
+    for (int i = 0; i < scores.size(); i++) sum += scores.at(i);
+    result.mean = sum/scores.size();
+
+    sort(scores.begin(), scores.end());
+    result.worst = scores.back();
+    int rank = ceil(percentileLevel*scores.size());
+    rank = min(max(rank, 1), int(scores.size()));
+    result.percentile = scores.at(rank - 1);
+    return result;
+}
+
+
+// Perturbations along the diagonal from (-heightStep, -velocityStep)*(numPoints-1)/2 to the opposite
+// corner, moving height and velocity together
+vector<MecoPerturbation> RobustObjective::diagonalPerturbations(int numPoints, double heightStep, double velocityStep)
+{
+    vector<MecoPerturbation> points;
+    double start = -(numPoints - 1)/2.0;
+    for (int i = 0; i < numPoints; i++)
+    {
+        MecoPerturbation point;
+        point.height = (start + i)*heightStep;
+        point.velocity = (start + i)*velocityStep;
+        points.push_back(point);
+    }
+    return points;
+}
+
+
+// Full grid of perturbations centred on the nominal MECO conditions
+vector<MecoPerturbation> RobustObjective::gridPerturbations(int numHeights, double heightStep, 
+    int numVelocities, double velocityStep)
+{
+    vector<MecoPerturbation> points;
+    for (int i = 0; i < numHeights; i++)
+    {
+        for (int j = 0; j < numVelocities; j++)
+        {
+            MecoPerturbation point;
+            point.height = (i - (numHeights - 1)/2.0)*heightStep;
+            point.velocity = (j - (numVelocities - 1)/2.0)*velocityStep;
+            points.push_back(point);
+        }
+    }
+    return points;
+}
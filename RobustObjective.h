@@ -0,0 +1,66 @@
+#ifndef ROBUST_OBJECTIVE_H
+#define ROBUST_OBJECTIVE_H
+
+/*
+File: RobustObjective.h
+Author: Gerritt Graham
+Description: Scores one set of PID gains against a list of perturbed MECO conditions instead of the
+nominal one, so the optimizer can tune for robustness directly. Every perturbation is an independent
+flight, so the flights are spread over worker threads, each with its own SimulationContext. Scores
+are collected per perturbation and summarized in list order, so the statistics do not depend on the
+number of threads.
+*/
+
+#include "consts.h"
+#include "OptimizerSolution.h"
+#include "SimulationContext.h"
+#include "ParallelFor.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Offset from the nominal MECO conditions
+struct MecoPerturbation
+{
+    double height, velocity;    //m, m/s
+};
+
+// Summary of the trajectory error over a list of perturbations
+struct RobustScore
+{
+    double mean;
+    double worst;
+    double percentile;          //error not exceeded by the given fraction of the perturbations
+};
+
+class RobustObjective
+{
+    public:
+    RobustObjective(const vector<MecoPerturbation>& perturbations, double percentileLevel = 0.9);
+    void setPerturbations(const vector<MecoPerturbation>& perturbations, double percentileLevel = 0.9);
+    int getNumPerturbations();
+    void setCache(EvaluationCache* cache);
+    void setControlPeriod(double controlPeriod);
+    RobustScore evaluate(const Solution& soln, int numThreads);
+    RobustScore evaluate(const Solution& soln, SimulationContext& context);
+    static vector<MecoPerturbation> diagonalPerturbations(int numPoints, double heightStep, double velocityStep);
+    static vector<MecoPerturbation> gridPerturbations(int numHeights, double heightStep, 
+        int numVelocities, double velocityStep);
+
+    private:
+    vector<MecoPerturbation> perturbations;
+    double percentileLevel;
+    vector<unique_ptr<SimulationContext>> contexts;     //one per worker thread
+    EvaluationCache* cache;
+    double controlPeriod;       //s, of the worker contexts
+
+    double scoreFlight(const Solution& soln, const MecoPerturbation& perturbation, SimulationContext& context);
+    RobustScore summarize(vector<double>& scores);
+
+};
+
+
+#endif //ROBUST_OBJECTIVE_H
@@ -0,0 +1,110 @@
+#include "SimulationContext.h"
+
+// Builds the simulation objects for the nominal MECO conditions. recordPolicy only needs to be
+// changed if the flights will be written out or inspected after scoring.
+SimulationContext::SimulationContext(RecordPolicy recordPolicy)
+    : simulator(mecoHeight, mecoVelocity), controller(0, 0, 0, mecoHeight, mecoVelocity)
+{
+    simulator.setRecordPolicy(recordPolicy);
+    cache = nullptr;
+    numFlights = numAborted = skippedSteps = 0;
+    lastAborted = false;
+}
+
+
+// Flies the rocket from the given MECO height (m) and velocity (m/s) with the given PID gains and
+// returns the trajectory error against the controller's reference trajectory. If a cache is attached
+// and already holds the flight, the cached score is returned without simulating, and the simulator
+// and controller keep the state of the previous flight. If the error passes cutoff the flight is
+// stopped and the error so far, a lower bound that is above cutoff, is returned. Stopped flights are
+// never cached.
+double SimulationContext::scoreGains(double kp, double ki, double kd, double h0, double V0, double cutoff)
+{
+    double score;
+    lastAborted = false;
+    if (cache && cache->lookup(kp, ki, kd, h0, V0, score)) return score;
+
+    controller.reset(kp, ki, kd, h0, V0);
+    accumulator.setReference(controller.getReference());
+    accumulator.setCutoff(cutoff);
+    simulator.setErrorAccumulator(&accumulator);
+    simulator.reset(h0, V0);
+
+    simulator.simulate(controller);
+    score = accumulator.getError();
+    numFlights++;
+    if (simulator.wasAborted())
+    {
+        lastAborted = true;
+        numAborted++;
+        skippedSteps += simulator.getSkippedSteps();
+        return score;
+    }
+
+    if (cache) cache->insert(kp, ki, kd, h0, V0, score);
+    return score;
+}
+
+
+// Returns true if the last call to scoreGains() returned a lower bound instead of the final error
+bool SimulationContext::lastFlightAborted()
+{
+    return lastAborted;
+}
+
+
+// Returns the number of flights simulated by this context, not counting cache hits
+long SimulationContext::getNumFlights()
+{
+    return numFlights;
+}
+
+
+// Returns the number of flights stopped at their cutoff
+long SimulationContext::getNumAborted()
+{
+    return numAborted;
+}
+
+
+// Returns the estimated number of integration steps saved by stopping flights at their cutoff
+long SimulationContext::getSkippedSteps()
+{
+    return skippedSteps;
+}
+
+
+// Attaches a cache of earlier scores, or detaches it if cache is nullptr
+void SimulationContext::setCache(EvaluationCache* cache)
+{
+    this->cache = cache;
+}
+
+
+// Runs the controller once per controlPeriod (s) in every flight, see Simulator::setControlPeriod().
+// The default of 0 runs it after every step.
+void SimulationContext::setControlPeriod(double controlPeriod)
+{
+    simulator.setControlPeriod(controlPeriod);
+}
+
+
+// Hashes everything besides the gains and MECO conditions that a flight's score depends on: the
+// reference data and selection of the controller, and the simulator's settings and model
+uint64_t SimulationContext::fingerprint()
+{
+    return simulator.hashSettings(controller.hashSettings());
+}
+
+
+// Returns the Simulator used for the last flight, e.g. to write its record
+Simulator& SimulationContext::getSimulator()
+{
+    return simulator;
+}
+
+
+Controller& SimulationContext::getController()
+{
+    return controller;
+}
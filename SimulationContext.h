@@ -0,0 +1,52 @@
+#ifndef SIMULATION_CONTEXT_H
+#define SIMULATION_CONTEXT_H
+
+/*
+File: SimulationContext.h
+Author: Gerritt Graham
+Description: Reusable set of objects needed to fly and score one controlled flight: a Simulator, a
+Controller and an ErrorAccumulator. The objects are built once and reset for every flight, so after
+the first flight an evaluation does not allocate any memory. A context is not thread safe; give each
+worker thread its own. A flight can be given a cutoff score, in which case it is stopped as soon as
+its error is known to be above the cutoff and a lower bound is returned instead of the final error.
+*/
+
+#include "consts.h"
+#include "Simulator.h"
+#include "Controller.h"
+#include "ErrorAccumulator.h"
+#include "EvaluationCache.h"
+#include <limits>
+
+using namespace std;
+
+class SimulationContext
+{
+    public:
+    SimulationContext(RecordPolicy recordPolicy = RECORD_NONE);
+    SimulationContext(const SimulationContext&) = delete;
+    SimulationContext& operator=(const SimulationContext&) = delete;
+    double scoreGains(double kp, double ki, double kd, double h0, double V0, 
+        double cutoff = numeric_limits<double>::infinity());
+    bool lastFlightAborted();
+    long getNumFlights();
+    long getNumAborted();
+    long getSkippedSteps();
+    void setCache(EvaluationCache* cache);
+    void setControlPeriod(double controlPeriod);
+    uint64_t fingerprint();
+    Simulator& getSimulator();
+    Controller& getController();
+
+    private:
+    Simulator simulator;
+    Controller controller;
+    ErrorAccumulator accumulator;
+    EvaluationCache* cache;     //optional, may be shared with other contexts
+    long numFlights, numAborted, skippedSteps;      //totals over every simulated flight
+    bool lastAborted;
+
+};
+
+
+#endif //SIMULATION_CONTEXT_H
@@ -13,6 +13,12 @@ steps until apogee.
 
 #include "consts.h"
 #include "Controller.h"
+#include "ReferenceStore.h"
+#include "ErrorAccumulator.h"
+#include "FlightRecord.h"
+#include "RecordWriter.h"
+#include "Instrumentation.h"
+#include "Hashing.h"
 
 #include <vector>
 #include <cmath>
@@ -21,9 +27,18 @@ steps until apogee.
 #include <iostream>
 #include <sstream>
 #include <ctime>
+#include <memory>
+#include <algorithm>
 
 using namespace std;
 
+// How the equations of motion are stepped from MECO to apogee
+enum IntegratorMode
+{
+    FIXED_STEP,         //energy balance every heightStep meters
+    ADAPTIVE_STEP       //energy balance with error controlled height steps
+};
+
 class Simulator
 {
     public:
@@ -34,6 +49,22 @@ class Simulator
     void writeRecord(string fileSpec = "");
     double calcError(int refFileNum);
     void reset(double h0, double V0, double alpha = -1);
+    void setErrorAccumulator(ErrorAccumulator* accumulator);
+    void setRecordPolicy(RecordPolicy policy, double interval = 0.1);
+    void setIntegrator(IntegratorMode mode, double apogeeTolerance = 0.1, double maxTimeStep = 0.05);
+    void setDispersion(double massScale, double dragScale);
+    void setControlPeriod(double controlPeriod);
+    int getNumControllerCalls();
+    int getNumSteps();
+    bool wasAborted();
+    int getSkippedSteps();
+    FlightRecord& getRecord();
+    uint64_t hashSettings(uint64_t hash = HASH_SEED);
+    static double getAirDensity(double h);
+    static double getPaddleDrag(double alpha);
+    static uint64_t hashModel(uint64_t hash = HASH_SEED);
+
+    static constexpr double HEIGHT_STEP = 0.05;    //m, fixed integrator step and adaptive minimum
 
     private:
     const string PARAMETERS_FILE = "parameters.txt";
@@ -41,13 +72,32 @@ class Simulator
 
     double h, V, a, currTime;
     double heightStep;
+    int numSteps;
+    bool aborted;               //true if the last flight was stopped by the accumulator's cutoff
+    int skippedSteps;           //estimated steps left to apogee when the flight was stopped
+
+    IntegratorMode integratorMode;
+    double apogeeTolerance;     //allowed apogee error of the adaptive integrator, m
+    double maxTimeStep;         //longest adaptive step, s
+    double adaptiveStepSize;    //height step the adaptive integrator will try next, m
+    double errorBudgetHeight;   //height over which the apogee tolerance is spread, m
+    double paddleCommand;       //rad, angle the paddles move toward during the next step
+    double nextControlTime;     //s, adaptive steps end here so the controller runs on time
     double fixedPaddleAngle;
+    double controlPeriod;       //s, 0 runs the controller after every step
+    int numControllerCalls;     //calls made during the last flight
+    double mass;                //kg, m_r unless dispersed with setDispersion()
+    double dragScale;           //multiplies the drag area of the rocket and paddles
+    ErrorAccumulator* accumulator;      //optional, scores the flight as it is simulated
     
-    vector<double> timeVals, heightVals, velocityVals, accelVals, alphaVals;
+    FlightRecord record;
 
     void calcNextStep(double& hOut, double& VOut, double& aOut, double& tOut, double alpha);
-    double getAirDensity(double h);
-    double getPaddleDrag(double alpha);
+    void energyStep(double hStart, double VStart, double paddleDrag, double dh, double& hEnd, double& VEnd);
+    double takeAdaptiveStep(double alpha);
+    bool trapezoidStep(double hStart, double VStart, double startDragArea, double endDragArea,
+        double dh, double& VEnd);
+    double coastHeight(double hStart, double VStart, double dragArea);
 
     //void populateParameters(ifstream& reader);
     vector<string> split(const string& s, char delimiter);
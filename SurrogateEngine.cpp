@@ -0,0 +1,236 @@
+#include "SurrogateEngine.h"
+
+SurrogateEngine::SurrogateEngine(int batchSize, int numInitialPoints)
+{
+    this->batchSize = max(batchSize, 1);
+    this->numInitialPoints = max(numInitialPoints, N + 2);
+    numCandidates = 1000;
+    initialRadius = 0.2;
+    minRadius = 1e-4;
+}
+
+
+string SurrogateEngine::getName()
+{
+    return "Surrogate";
+}
+
+
+// Flies a Latin hypercube design and the start point, then runs screening rounds until the budget is
+// spent or the sampling radius collapses
+Solution SurrogateEngine::optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+    Solution startSoln, int maxEvaluations, mt19937& rng)
+{
+    points.clear();
+    values.clear();
+    uniform_real_distribution<double> unit(0, 1);
+    normal_distribution<double> gaussian(0, 1);
+
+    Solution bestSoln;
+    int bestPoint = -1;
+    int numEvaluations = 0;
+    auto flyBatch = [&](vector<vector<double>>& batchPoints)
+    {
+        vector<Solution> batch;
+        for (int k = 0; k < batchPoints.size(); k++) batch.push_back(denormalize(batchPoints.at(k), bounds));
+        scoreBatch(batch);
+        numEvaluations += batch.size();
+
+        bool improved = false;
+        for (int k = 0; k < batch.size(); k++)
+        {
+            points.push_back(batchPoints.at(k));
+            values.push_back(log(max(batch.at(k).score, 1e-12)));
+            if (bestPoint < 0 || batch.at(k).score < bestSoln.score)
+            {
+                bestSoln.equals(batch.at(k));
+                bestPoint = points.size() - 1;
+                improved = true;
+            }
+        }
+        return improved;
+    };
+
+    // initial design: the start point plus a Latin hypercube over the bounds
+    int numDesign = min(numInitialPoints, maxEvaluations);
+    vector<vector<double>> design(numDesign, vector<double>(N));
+    design.at(0) = normalize(startSoln, bounds);
+    clampToUnitCube(design.at(0));
+    for (int i = 0; i < N; i++)
+    {
+        vector<int> strata(numDesign - 1);
+        iota(strata.begin(), strata.end(), 0);
+        shuffle(strata.begin(), strata.end(), rng);
+        for (int k = 1; k < numDesign; k++) design.at(k).at(i) = (strata.at(k - 1) + unit(rng))/(numDesign - 1);
+    }
+    flyBatch(design);
+
+    const double MERIT_WEIGHTS[] = {0.3, 0.5, 0.8, 0.95};   //weight on the predicted score
+    double radius = initialRadius;
+    int failedRounds = 0, round = 0;
+    while (numEvaluations < maxEvaluations && radius > minRadius)
+    {
+        if (!fitModel()) break;
+
+        // candidates: perturbations of the best point and uniform samples over the whole space
+        vector<vector<double>> candidates(numCandidates, vector<double>(N));
+        for (int k = 0; k < numCandidates; k++)
+        {
+            for (int i = 0; i < N; i++)
+            {
+                double& x = candidates.at(k).at(i);
+                if (k < numCandidates*3/4) x = points.at(bestPoint).at(i) + radius*gaussian(rng);
+                else x = unit(rng);
+
+                // reflect off the bounds so candidates do not pile up on them
+                if (x < 0) x = -x;
+                if (x > 1) x = 2 - x;
+            }
+            clampToUnitCube(candidates.at(k));
+        }
+
+        vector<double> predicted(numCandidates), distance(numCandidates);
+        for (int k = 0; k < numCandidates; k++)
+        {
+            predicted.at(k) = predict(candidates.at(k));
+            distance.at(k) = numeric_limits<double>::infinity();
+            for (int p = 0; p < points.size(); p++)
+            {
+                double d = 0;
+                for (int i = 0; i < N; i++) d += pow(candidates.at(k).at(i) - points.at(p).at(i), 2);
+                distance.at(k) = min(distance.at(k), sqrt(d));
+            }
+        }
+
+        // pick the batch one candidate at a time, keeping picks apart from each other
+        int numPicks = min(batchSize, maxEvaluations - numEvaluations);
+        vector<vector<double>> picks;
+        for (int pick = 0; pick < numPicks; pick++)
+        {
+            double weight = MERIT_WEIGHTS[(round*batchSize + pick) % 4];
+            double minPredicted = *min_element(predicted.begin(), predicted.end());
+            double maxPredicted = *max_element(predicted.begin(), predicted.end());
+            double minDistance = numeric_limits<double>::infinity(), maxDistance = 0;
+            for (int k = 0; k < numCandidates; k++)
+            {
+                if (distance.at(k) <= 0) continue;
+                minDistance = min(minDistance, distance.at(k));
+                maxDistance = max(maxDistance, distance.at(k));
+            }
+
+            int chosen = -1;
+            double bestMerit = numeric_limits<double>::infinity();
+            for (int k = 0; k < numCandidates; k++)
+            {
+                if (distance.at(k) < 1e-3*radius) continue;     //already flown or picked
+                double scoreTerm = (maxPredicted > minPredicted) ? 
+                    (predicted.at(k) - minPredicted)/(maxPredicted - minPredicted) : 1;
+                double distanceTerm = (maxDistance > minDistance) ? 
+                    (maxDistance - distance.at(k))/(maxDistance - minDistance) : 1;
+                double merit = weight*scoreTerm + (1 - weight)*distanceTerm;
+                if (merit < bestMerit)
+                {
+                    bestMerit = merit;
+                    chosen = k;
+                }
+            }
+            if (chosen < 0) break;
+
+            picks.push_back(candidates.at(chosen));
+            for (int k = 0; k < numCandidates; k++)
+            {
+                double d = 0;
+                for (int i = 0; i < N; i++) d += pow(candidates.at(k).at(i) - candidates.at(chosen).at(i), 2);
+                distance.at(k) = min(distance.at(k), sqrt(d));
+            }
+        }
+        if (picks.empty())
+        {
+            radius /= 2;
+            continue;
+        }
+
+        // shrink the sampling radius after repeated rounds without improvement
+        if (flyBatch(picks)) failedRounds = 0;
+        else if (++failedRounds >= 3)
+        {
+            radius /= 2;
+            failedRounds = 0;
+        }
+        round++;
+    }
+
+    return bestSoln;
+}
+
+
+// Fits the cubic RBF with a linear tail through every point flown so far. Returns false if the
+// system is singular.
+bool SurrogateEngine::fitModel()
+{
+    int n = points.size();
+    int size = n + N + 1;
+    vector<vector<double>> A(size, vector<double>(size, 0));
+    vector<double> b(size, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            double d = 0;
+            for (int k = 0; k < N; k++) d += pow(points.at(i).at(k) - points.at(j).at(k), 2);
+            A.at(i).at(j) = pow(sqrt(d), 3);
+        }
+        A.at(i).at(n) = A.at(n).at(i) = 1;
+        for (int k = 0; k < N; k++) A.at(i).at(n + 1 + k) = A.at(n + 1 + k).at(i) = points.at(i).at(k);
+        b.at(i) = values.at(i);
+    }
+
+    if (!solveLinearSystem(A, b)) return false;
+    coefficients = b;
+    return true;
+}
+
+
+double SurrogateEngine::predict(const vector<double>& x)
+{
+    int n = points.size();
+    double value = coefficients.at(n);
+    for (int k = 0; k < N; k++) value += coefficients.at(n + 1 + k)*x.at(k);
+    for (int i = 0; i < n; i++)
+    {
+        double d = 0;
+        for (int k = 0; k < N; k++) d += pow(x.at(k) - points.at(i).at(k), 2);
+        value += coefficients.at(i)*pow(sqrt(d), 3);
+    }
+    return value;
+}
+
+
+// Gaussian elimination with partial pivoting. The solution replaces b.
+bool SurrogateEngine::solveLinearSystem(vector<vector<double>>& A, vector<double>& b)
+{
+    int n = b.size();
+    for (int col = 0; col < n; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) if (abs(A.at(row).at(col)) > abs(A.at(pivot).at(col))) pivot = row;
+        if (abs(A.at(pivot).at(col)) < 1e-14) return false;
+        swap(A.at(col), A.at(pivot));
+        swap(b.at(col), b.at(pivot));
+
+        for (int row = col + 1; row < n; row++)
+        {
+            double factor = A.at(row).at(col)/A.at(col).at(col);
+            if (factor == 0) continue;
+            for (int k = col; k < n; k++) A.at(row).at(k) -= factor*A.at(col).at(k);
+            b.at(row) -= factor*b.at(col);
+        }
+    }
+    for (int row = n - 1; row >= 0; row--)
+    {
+        for (int k = row + 1; k < n; k++) b.at(row) -= A.at(row).at(k)*b.at(k);
+        b.at(row) /= A.at(row).at(row);
+    }
+    return true;
+}
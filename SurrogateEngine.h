@@ -0,0 +1,52 @@
+#ifndef SURROGATE_ENGINE_H
+#define SURROGATE_ENGINE_H
+
+/*
+File: SurrogateEngine.h
+Author: Gerritt Graham
+Description: Surrogate assisted search for tuning the PID gains. Every flight is expensive but the gain
+space is only 3-D, so a radial basis function (RBF) model fitted to every scored Solution is cheap to
+evaluate by comparison. Each round, thousands of candidate gains are generated around the best
+solution so far and across the whole space, the model screens them, and only a small batch of the
+most promising candidates is flown in parallel. Candidates are ranked on a mix of predicted score and
+distance from the points already flown, cycling from exploration toward exploitation, and the
+sampling radius shrinks when rounds stop improving. The model is a cubic RBF with a linear tail,
+fitted to the log of the score because scores span several orders of magnitude.
+*/
+
+#include "OptimizerEngine.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+using namespace std;
+
+class SurrogateEngine : public OptimizerEngine
+{
+    public:
+    SurrogateEngine(int batchSize = 4, int numInitialPoints = 21);
+    string getName();
+    Solution optimize(const BatchObjective& scoreBatch, const vector<double>& bounds,
+        Solution startSoln, int maxEvaluations, mt19937& rng);
+
+    private:
+    static const int N = 3;     //kp, ki, kd
+    int batchSize;              //real flights per round
+    int numInitialPoints;       //flights in the initial space filling design, including the start point
+    int numCandidates;          //candidates screened by the model per round
+    double initialRadius, minRadius;    //sampling radius around the best point, normalized units
+
+    vector<vector<double>> points;      //every point flown, normalized
+    vector<double> values;              //log of each point's score
+    vector<double> coefficients;        //RBF weights followed by the linear tail
+
+    bool fitModel();
+    double predict(const vector<double>& x);
+    static bool solveLinearSystem(vector<vector<double>>& A, vector<double>& b);
+
+};
+
+
+#endif //SURROGATE_ENGINE_H
@@ -0,0 +1,187 @@
+#include "TextReader.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Maps filename into memory. isOpen() is false if the file cannot be read. On systems without mmap
+// the file is read into memory in one piece instead.
+TextReader::TextReader(const string& filename)
+{
+    this->filename = filename;
+    mapping = nullptr;
+    mappingSize = 0;
+    isMapped = false;
+    opened = false;
+    lineNum = 0;
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo) == 0)
+        {
+            mappingSize = fileInfo.st_size;
+            opened = true;
+            if (mappingSize > 0)    //empty files cannot be mapped and have nothing to read
+            {
+                void* mapped = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) opened = false;
+                else
+                {
+                    mapping = (const char*)mapped;
+                    isMapped = true;
+                }
+            }
+        }
+        close(fd);
+    }
+#else
+    ifstream reader(filename, ios::binary | ios::ate);
+    if (reader.is_open())
+    {
+        mappingSize = reader.tellg();
+        char* buffer = new char[mappingSize];
+        reader.seekg(0);
+        reader.read(buffer, mappingSize);
+        mapping = buffer;
+        opened = true;
+    }
+#endif
+
+    if (!opened) mappingSize = 0;
+    next = mapping;
+    end = mapping + mappingSize;
+    lineStart = lineEnd = cursor = mapping;
+}
+
+
+TextReader::~TextReader()
+{
+#ifndef _WIN32
+    if (isMapped) munmap((void*)mapping, mappingSize);
+#else
+    delete[] mapping;
+#endif
+}
+
+
+bool TextReader::isOpen()
+{
+    return opened;
+}
+
+
+// Skips numLines lines, such as a file header, without looking at their contents
+void TextReader::skipLines(int numLines)
+{
+    for (int i = 0; i < numLines && nextLine(); i++);
+}
+
+
+// Returns the number of lines left to read, counting a last line without a line ending. Used to size
+// buffers before parsing.
+size_t TextReader::countRemainingLines()
+{
+    size_t numLines = 0;
+    for (const char* position = next; position < end; numLines++)
+    {
+        const char* newline = (const char*)memchr(position, '\n', end - position);
+        position = newline ? newline + 1 : end;
+    }
+    return numLines;
+}
+
+
+// Moves to the next line. Returns false once the end of the file is reached.
+bool TextReader::nextLine()
+{
+    if (next >= end) return false;
+
+    lineStart = next;
+    const char* newline = (const char*)memchr(next, '\n', end - next);
+    lineEnd = newline ? newline : end;
+    next = newline ? newline + 1 : end;
+    if (lineEnd > lineStart && lineEnd[-1] == '\r') lineEnd--;
+
+    cursor = lineStart;
+    lineNum++;
+    return true;
+}
+
+
+// Returns true if the rest of the current line is empty or only whitespace
+bool TextReader::lineIsBlank()
+{
+    skipSpaces();
+    return cursor == lineEnd;
+}
+
+
+// Parses the next field of the current line as a double. Returns false, leaving the field unread, if
+// there is no field or it is not entirely a number.
+bool TextReader::readNumber(double& value)
+{
+    skipSpaces();
+    double parsed;
+    from_chars_result result = from_chars(cursor, lineEnd, parsed);
+    if (result.ec != errc() || !atFieldEnd(result.ptr)) return false;
+
+    value = parsed;
+    cursor = result.ptr;
+    return true;
+}
+
+
+// Parses the next field of the current line as an int, like readNumber(double&)
+bool TextReader::readNumber(int& value)
+{
+    skipSpaces();
+    int parsed;
+    from_chars_result result = from_chars(cursor, lineEnd, parsed);
+    if (result.ec != errc() || !atFieldEnd(result.ptr)) return false;
+
+    value = parsed;
+    cursor = result.ptr;
+    return true;
+}
+
+
+// Returns the next whitespace separated field of the current line. The view points into the mapping
+// and is only valid while the reader exists. Returns false if the line has no fields left.
+bool TextReader::readToken(string_view& token)
+{
+    skipSpaces();
+    const char* start = cursor;
+    while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t') cursor++;
+    token = string_view(start, cursor - start);
+    return cursor > start;
+}
+
+
+// Prints the file name, number and text of the current line as a line caller could not use
+void TextReader::reportMalformed(const string& caller)
+{
+    cout << "Malformed line " << lineNum << " in " << filename << " in " << caller << ": \""
+        << string_view(lineStart, lineEnd - lineStart) << "\"" << endl;
+}
+
+
+void TextReader::skipSpaces()
+{
+    while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) cursor++;
+}
+
+
+// A parsed number must be followed by whitespace or the end of the line, so "12abc" is not read as 12
+bool TextReader::atFieldEnd(const char* position)
+{
+    return position == lineEnd || *position == ' ' || *position == '\t';
+}
@@ -0,0 +1,57 @@
+#ifndef TEXT_READER_H
+#define TEXT_READER_H
+
+/*
+File: TextReader.h
+Author: Gerritt Graham
+Description: Line reader for the whitespace separated text files written by this program (reference
+trajectories and the reference index). The file is memory mapped and parsed in place: numbers are
+read with std::from_chars straight from the mapping, so no strings or streams are built per line.
+A field only counts as a number if the whole field parses, and callers report lines that do not hold
+the fields they expect with reportMalformed() instead of storing whatever was read. Lines may end in
+"\n" or "\r\n".
+*/
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstddef>
+
+using namespace std;
+
+class TextReader
+{
+    public:
+    TextReader(const string& filename);
+    ~TextReader();
+    TextReader(const TextReader&) = delete;
+    TextReader& operator=(const TextReader&) = delete;
+
+    bool isOpen();
+    void skipLines(int numLines);
+    size_t countRemainingLines();
+    bool nextLine();
+    bool lineIsBlank();
+    bool readNumber(double& value);
+    bool readNumber(int& value);
+    bool readToken(string_view& token);
+    void reportMalformed(const string& caller);
+
+    private:
+    string filename;
+    const char* mapping;        //start of the mapped (or, without mmap, loaded) file
+    size_t mappingSize;
+    bool isMapped;
+    bool opened;
+    const char *next, *end;             //start of the next unread line and end of the file
+    const char *lineStart, *lineEnd;    //current line without its line ending
+    const char* cursor;                 //next unread character of the current line
+    int lineNum;                        //1-based number of the current line
+
+    void skipSpaces();
+    bool atFieldEnd(const char* position);
+
+};
+
+
+#endif //TEXT_READER_H
@@ -0,0 +1,361 @@
+/*
+File: benchmarks.cpp
+Author: Gerritt Graham
+Description: Benchmark suite for the simulation hot paths. Every case uses fixed seeds and fixed
+iteration counts, so runs on different commits do the same work and their checksums should match
+unless results changed. Each case is repeated and the median and fastest repetitions are reported,
+along with simulations per second, nanoseconds per height step where a case steps a flight, and heap
+allocations per operation (counted by replacing the global operator new). Results are printed as a
+table and written as JSON for tracking regressions across commits.
+Build and run with runbench.sh, which works on a scratch copy of SimRecords because the Generator case
+rewrites the reference files.
+*/
+
+#include "../Simulator.h"
+#include "../BatchSimulator.h"
+#include "../Controller.h"
+#include "../SimulationContext.h"
+#include "../RobustObjective.h"
+#include "../Generator.h"
+#include "../DispersionEngine.h"
+#include "../ReferenceStore.h"
+#include "../consts.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<long> numAllocations(0);
+
+void* operator new(size_t size)
+{
+    numAllocations++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    numAllocations++;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return operator new(size, nothrow);
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+
+// Work done by one repetition of a case. steps is the number of height steps flown, or 0 if the case
+// does not step flights, and simulations the number of flights simulated.
+struct CaseWork
+{
+    long steps = 0;
+    long simulations = 0;
+    double checksum = 0;
+};
+
+// Summary of every repetition of a case
+struct CaseResult
+{
+    string name;
+    int operations;                     //operations per repetition
+    int repetitions;
+    double medianNs, minNs;             //per operation
+    double stepsPerOp, simulationsPerOp;
+    double allocationsPerOp;
+    double checksum;                    //of the last repetition
+};
+
+// Runs body repetitions times. Each call of body does operations operations and returns the work it did.
+CaseResult runCase(const string& name, int operations, int repetitions, const function<CaseWork()>& body)
+{
+    vector<double> timesNs;
+    CaseWork work;
+    long allocations = 0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        long allocationsBefore = numAllocations;
+        auto start = chrono::steady_clock::now();
+        work = body();
+        auto stop = chrono::steady_clock::now();
+        allocations += numAllocations - allocationsBefore;
+        timesNs.push_back(chrono::duration<double, nano>(stop - start).count() / operations);
+    }
+    sort(timesNs.begin(), timesNs.end());
+
+    CaseResult result;
+    result.name = name;
+    result.operations = operations;
+    result.repetitions = repetitions;
+    result.medianNs = timesNs.at(timesNs.size()/2);
+    result.minNs = timesNs.front();
+    result.stepsPerOp = double(work.steps) / operations;
+    result.simulationsPerOp = double(work.simulations) / operations;
+    result.allocationsPerOp = double(allocations) / (double(operations)*repetitions);
+    result.checksum = work.checksum;
+
+    cout.precision(6);
+    cout << name << ": " << result.medianNs << " ns/op (min " << result.minNs << ")";
+    if (result.stepsPerOp > 0) cout << ", " << result.medianNs/result.stepsPerOp << " ns/step";
+    if (result.simulationsPerOp > 0) cout << ", " << 1e9*result.simulationsPerOp/result.medianNs << " simulations/s";
+    cout << ", " << result.allocationsPerOp << " allocations/op" << endl;
+    return result;
+}
+
+
+// MECO conditions spread around the nominal ones, the same on every run
+vector<pair<double, double>> mecoConditions(int count, unsigned int seed)
+{
+    mt19937 rng(seed);
+    uniform_real_distribution<double> heightOffset(-20, 20), velocityOffset(-10, 10);
+    vector<pair<double, double>> conditions;
+    for (int i = 0; i < count; i++)
+    {
+        double h0 = mecoHeight + heightOffset(rng);
+        conditions.push_back(make_pair(h0, mecoVelocity + velocityOffset(rng)));
+    }
+    return conditions;
+}
+
+
+void writeJson(const string& filename, const string& commit, const vector<CaseResult>& results)
+{
+    ofstream writer(filename);
+    if (!writer.is_open())
+    {
+        cout << "Results file " << filename << " did not open in writeJson()." << endl;
+        return;
+    }
+
+    writer.precision(17);
+    writer << "{" << endl;
+    writer << "  \"commit\": \"" << commit << "\"," << endl;
+    writer << "  \"compiler\": \"" << __VERSION__ << "\"," << endl;
+    writer << "  \"batch_kernel\": \"" << BatchSimulator::kernelName() << "\"," << endl;
+    writer << "  \"cases\": [" << endl;
+    for (int i = 0; i < results.size(); i++)
+    {
+        const CaseResult& result = results.at(i);
+        double stepNs = (result.stepsPerOp > 0) ? result.medianNs/result.stepsPerOp : 0;
+        double simulationsPerSecond = (result.simulationsPerOp > 0) ? 1e9*result.simulationsPerOp/result.medianNs : 0;
+        writer << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+            << ", \"repetitions\": " << result.repetitions << ", \"ns_per_op\": " << result.medianNs
+            << ", \"ns_per_op_min\": " << result.minNs << ", \"ns_per_step\": " << stepNs
+            << ", \"simulations_per_s\": " << simulationsPerSecond << ", \"allocations_per_op\": "
+            << result.allocationsPerOp << ", \"checksum\": " << result.checksum << "}";
+        writer << ((i + 1 < results.size()) ? "," : "") << endl;
+    }
+    writer << "  ]" << endl;
+    writer << "}" << endl;
+}
+
+
+// Usage: bench [results.json] [commit]
+int main(int argc, char* argv[])
+{
+    string resultsFile = (argc > 1) ? argv[1] : "benchmark.json";
+    string commit = (argc > 2) ? argv[2] : "unknown";
+
+    const double KP = 13.2434, KI = 1.64725, KD = 0.092556;     //gains used by Simulate mode
+    const int REPETITIONS = 5;
+    vector<CaseResult> results;
+    vector<pair<double, double>> conditions = mecoConditions(200, 1);
+
+    // warm the reference store so the simulation cases do not time file reads
+    Controller warmup(KP, KI, KD, mecoHeight, mecoVelocity);
+
+    results.push_back(runCase("simulate_fixed_angle", 200, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        Controller dummyController(0, 0, 0, 0, 0);
+        Simulator sim(mecoHeight, mecoVelocity, 0);
+        sim.setRecordPolicy(RECORD_NONE);
+        mt19937 rng(2);
+        uniform_real_distribution<double> angle(0, MAX_PADDLE_ANGLE);
+        for (auto& meco : conditions)
+        {
+            sim.reset(meco.first, meco.second, angle(rng));
+            sim.simulate(dummyController);
+            work.steps += sim.getNumSteps();
+            work.simulations++;
+            work.checksum += sim.getApogee();
+        }
+        return work;
+    }));
+
+    results.push_back(runCase("simulate_controlled", 200, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        Controller controller(KP, KI, KD, mecoHeight, mecoVelocity);
+        Simulator sim(mecoHeight, mecoVelocity);
+        sim.setRecordPolicy(RECORD_NONE);
+        for (auto& meco : conditions)
+        {
+            controller.reset(KP, KI, KD, meco.first, meco.second);
+            sim.reset(meco.first, meco.second);
+            sim.simulate(controller);
+            work.steps += sim.getNumSteps();
+            work.simulations++;
+            work.checksum += sim.getApogee();
+        }
+        return work;
+    }));
+
+    // the same flights as simulate_controlled flown in one batch, so the checksums match without FMA
+    results.push_back(runCase("batch_simulate_controlled", 200, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        vector<unique_ptr<Controller>> controllers;
+        BatchSimulator batch;
+        for (auto& meco : conditions)
+        {
+            controllers.emplace_back(new Controller(KP, KI, KD, meco.first, meco.second));
+            batch.addFlight(meco.first, meco.second, -1, controllers.back().get());
+        }
+        batch.simulate();
+        for (int i = 0; i < batch.getNumFlights(); i++)
+        {
+            work.steps += batch.getNumSteps(i);
+            work.simulations++;
+            work.checksum += batch.getApogee(i);
+        }
+        return work;
+    }));
+
+    results.push_back(runCase("dispersion_run", 1000, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        DispersionEngine dispersion(1);
+        dispersion.setGains(KP, KI, KD);
+        dispersion.setControlPeriod(CONTROL_PERIOD);
+        StreamingStats stats = dispersion.run(1000);
+        work.simulations = stats.getCount();
+        work.checksum = stats.getMean();
+        return work;
+    }));
+
+    // one fully recorded controlled flight, replayed through the controller and the error calculation
+    Controller recordedController(KP, KI, KD, mecoHeight, mecoVelocity);
+    Simulator recordedSim(mecoHeight, mecoVelocity);
+    recordedSim.setRecordPolicy(RECORD_FULL);
+    recordedSim.simulate(recordedController);
+    FlightRecord& flight = recordedSim.getRecord();
+    int recordedTrajectory = recordedController.getTrajectoryNum();
+
+    results.push_back(runCase("controller_calc_angle", flight.size(), REPETITIONS, [&]()
+    {
+        CaseWork work;
+        Controller controller(KP, KI, KD, mecoHeight, mecoVelocity);
+        for (int i = 0; i < flight.size(); i++)
+        {
+            work.checksum += controller.calcAngle(flight.timeVals.at(i), flight.heightVals.at(i),
+                flight.velocityVals.at(i), flight.accelVals.at(i));
+        }
+        return work;
+    }));
+
+    results.push_back(runCase("simulator_calc_error", 100, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        for (int i = 0; i < 100; i++)
+        {
+            work.checksum += recordedSim.calcError(recordedTrajectory);
+            work.steps += flight.size();
+        }
+        return work;
+    }));
+
+    results.push_back(runCase("reference_loading", 20, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        for (int i = 0; i < 20; i++)
+        {
+            shared_ptr<const vector<ReferenceIndexEntry>> index = ReferenceStore::readTextIndex();
+            for (const ReferenceIndexEntry& entry : *index)
+            {
+                shared_ptr<const ReferenceTrajectory> trajectory = ReferenceStore::readTextTrajectory(entry.trajectoryNum);
+                work.checksum += trajectory->numSamples;
+            }
+        }
+        return work;
+    }));
+
+    // the nominal optimizer objective is one scoreGains() call per candidate
+    results.push_back(runCase("objective_nominal", 200, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        SimulationContext context;
+        mt19937 rng(3);
+        uniform_real_distribution<double> scale(0.5, 1.5);
+        for (int i = 0; i < 200; i++)
+        {
+            work.checksum += context.scoreGains(KP*scale(rng), KI*scale(rng), KD*scale(rng), mecoHeight, mecoVelocity);
+            work.steps += context.getSimulator().getNumSteps();
+        }
+        work.simulations = context.getNumFlights();
+        return work;
+    }));
+
+    results.push_back(runCase("objective_robust", 20, REPETITIONS, [&]()
+    {
+        CaseWork work;
+        SimulationContext context;
+        RobustObjective objective(RobustObjective::diagonalPerturbations(5, 20, 10));
+        mt19937 rng(4);
+        uniform_real_distribution<double> scale(0.5, 1.5);
+        for (int i = 0; i < 20; i++)
+        {
+            Solution soln(KP*scale(rng), KI*scale(rng), KD*scale(rng));
+            work.checksum += objective.evaluate(soln, context).mean;
+        }
+        work.simulations = context.getNumFlights();
+        return work;
+    }));
+
+    // a single threaded sweep of the default grid, with Generator output hidden
+    results.push_back(runCase("generator_sweep", 1, 3, [&]()
+    {
+        CaseWork work;
+        stringstream hidden;
+        streambuf* coutBuffer = cout.rdbuf(hidden.rdbuf());
+        Generator generator(1);
+        generator.setIncremental(false);
+        generator.generateTrajectories();
+        cout.rdbuf(coutBuffer);
+
+        // the summary line reads "Generated N of M trajectories using S simulations ..."
+        string output = hidden.str();
+        size_t found = output.rfind(" using ");
+        if (found != string::npos) work.simulations = atol(output.c_str() + found + 7);
+
+        for (const ReferenceIndexEntry& entry : *ReferenceStore::instance().getIndex()) work.checksum += entry.trajectoryNum;
+        return work;
+    }));
+
+    writeJson(resultsFile, commit, results);
+    cout << "Results written to " << resultsFile << endl;
+    return 0;
+}
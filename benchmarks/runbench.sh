@@ -0,0 +1,14 @@
+# Builds the benchmark suite with optimization and runs it on a scratch copy of SimRecords, because the
+# Generator case rewrites the reference files. Results are written to benchmarks/results.json.
+# Extra compiler flags can be given in SIM_ARCH_FLAGS, e.g. SIM_ARCH_FLAGS=-mavx2 or -march=native to
+# build the AVX2 or AVX-512 kernels of BatchSimulator. The default build is portable x86-64.
+# Usage: [SIM_ARCH_FLAGS=...] benchmarks/runbench.sh [results.json]
+repoDir=$(cd "$(dirname "$0")/.." && pwd)
+resultsFile=$(realpath -m "${1:-$repoDir/benchmarks/results.json}")
+commit=$(git -C "$repoDir" rev-parse --short HEAD 2>/dev/null || echo unknown)
+workDir=$(mktemp -d)
+
+g++ -O2 $SIM_ARCH_FLAGS -pthread $(ls "$repoDir"/*.cpp | grep -v '/main\.cpp$') "$repoDir"/benchmarks/benchmarks.cpp -o "$workDir"/bench \
+    && cp -r "$repoDir"/SimRecords "$workDir"/ \
+    && (cd "$workDir" && ./bench "$resultsFile" "$commit")
+rm -rf "$workDir"
@@ -7,6 +7,8 @@
 const std::string REF_DIRECTORY = "SimRecords/References/";
 const std::string REF_FILE_BASE = "refData";
 const std::string INDEX_FILE_NAME = "index.txt";
+const std::string ARCHIVE_FILE_NAME = "references.bin";
+const std::string MANIFEST_FILE_NAME = "manifest.txt";
 const int REF_HEADER_SIZE = 5;
 
 const double TARGET_APOGEE = 3048;      //m
@@ -22,6 +24,7 @@ const double launchPadHeight = 1293;    //height of the launchpad above sealevel
 const double A_r = M_PI*(D_r/2)*(D_r/2);    //frontal area of the rocket, m^2
 const double g = 9.80665;               //acceleration of gravity, m/s^2
 const double t_c = 3.6;
+const double CONTROL_PERIOD = 0.01;     //period of the flight computer's control loop, s
 
 const double mecoHeight = 679.84;     //height of the rocket at MECO obtained from OpenRocket, meters
 const double mecoVelocity = 304.148;     //velocity of the rocket at MECO obtained from OpenRocket, m/s
@@ -13,6 +13,8 @@ Description: Main file used to run the various simulation analyses.
 #include "Controller.h"
 #include "Generator.h"
 #include "GainOptimizer.h"
+#include "ReferenceArchive.h"
+#include "DispersionEngine.h"
 
 using namespace std;
 
@@ -26,29 +28,85 @@ int main()
     string operationMode = "Simulate";
     //string operationMode = "Generate";
     //string operationMode = "Optimize";
+    //string operationMode = "Convert";
+    //string operationMode = "Compare";
+    //string operationMode = "Dispersion";
     
 
     if (operationMode == "Simulate")
     {
         Simulator currSim(mecoHeight+5, mecoVelocity-6);
         Controller controller(13.2434,1.64725,0.092556, mecoHeight+5, mecoVelocity-6);
+        currSim.setRecordPolicy(RECORD_DECIMATED, 0.1);     //writeRecord() only keeps 0.1 s spacing
+        currSim.setControlPeriod(CONTROL_PERIOD);           //run the controller at the flight computer's rate
         
         currSim.simulate(controller);
+        cout << "Apogee: " << currSim.getApogee() << " m, " << currSim.getNumControllerCalls() << " controller calls over "
+            << currSim.getNumSteps() << " steps." << endl;
         
         currSim.writeRecord("SimRecords/simulation1.txt");
     }
 
     else if (operationMode == "Generate")
     {
-        Generator trajectoryGenerator;
+        Generator trajectoryGenerator(0);   //0 uses every core
         trajectoryGenerator.generateTrajectories();
     }
 
     else if (operationMode == "Optimize")
     {
-        GainOptimizer optimizer;
+        GainOptimizer optimizer(0);     //0 uses every core
+        optimizer.setControlPeriod(CONTROL_PERIOD);     //tune for the flight computer's rate
+
+        // reuse scores from earlier sessions, the file is discarded if the references or settings changed
+        EvaluationCache cache;
+        optimizer.setCache(&cache);
+        cache.load("SimRecords/evaluationCache.txt");
+
         //optimizer.evaluate();
         optimizer.findPerturbationSolution();
+
+        cache.printStats();
+        cache.save("SimRecords/evaluationCache.txt");
+    }
+
+    else if (operationMode == "Compare")
+    {
+        // tune the nominal gains with every engine from the same seed and compare their cost
+        OptimizerEngineType engines[] = {ENGINE_ANNEALING, ENGINE_CMAES, ENGINE_NELDER_MEAD, ENGINE_SURROGATE};
+        vector<string> summaries;
+        for (OptimizerEngineType engine : engines)
+        {
+            GainOptimizer optimizer(0);
+            optimizer.setSeed(1);
+            optimizer.setEngine(engine);
+            Solution best = optimizer.optimize();
+
+            stringstream summary;
+            summary << GainOptimizer::engineName(engine) << ": score " << best.score << ", " 
+                << optimizer.getEvaluationsToConverge() << " of " << optimizer.getNumEvaluations() 
+                << " simulations to converge";
+            summaries.push_back(summary.str());
+        }
+        for (int i = 0; i < summaries.size(); i++) cout << summaries.at(i) << endl;
+    }
+
+    else if (operationMode == "Convert")
+    {
+        // pack the text reference files into a binary archive for faster loading
+        ReferenceArchive::convertTextReferences();
+    }
+
+    else if (operationMode == "Dispersion")
+    {
+        // Monte Carlo spread of the apogee with the Simulate mode gains
+        DispersionEngine dispersion(0);     //0 uses every core
+        dispersion.setGains(13.2434,1.64725,0.092556);
+        dispersion.setSeed(1);
+        dispersion.setControlPeriod(CONTROL_PERIOD);
+        StreamingStats stats = dispersion.run(4000);
+        DispersionEngine::printSummary(stats);
+        stats.writeHistogram("SimRecords/dispersion.txt");
     }
 
     else
@@ -56,5 +114,9 @@ int main()
         cout << "Invalid value of operationMode used: " << operationMode << endl;
     }
 
+    // summary of where the run spent its time, when built with -DSIM_INSTRUMENTATION
+    RecordWriter::instance().flush();
+    INSTRUMENT_REPORT("SimRecords/instrumentation.json");
+
     return 0;
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
-g++ *.cpp -o run
+# Set SIM_ARCH_FLAGS (e.g. -mavx2 or -march=native) to build BatchSimulator's vector kernels
+g++ -O2 $SIM_ARCH_FLAGS *.cpp -pthread -o run
 ./run
 rm run
\ No newline at end of file